@@ -22,13 +22,112 @@
 
 #include <stm32f4xx_ll_rcc.h>
 #include <stm32f4xx_ll_system.h>
+#include <stm32f4xx_ll_tim.h>
 #include <stm32f4xx_ll_utils.h>
 #include <stm32f4xx_ll_bus.h>
 
 #include "bsp/bsp.h"
+#include "bsp/bsp_clock.h"
+#include "bsp/bsp_crash.h"
+#include "bsp/bsp_dma.h"
+#include "bsp/bsp_evlog.h"
 #include "bsp/bsp_gpio.h"
 #include "bsp/bsp_tty.h"
 #include "bsp/bsp_exti.h"
+#include "bsp/bsp_isr.h"
+#include "bsp/bsp_prof.h"
+#include "bsp/bsp_rtos.h"
+#include "bsp/bsp_wave.h"
+#include "bsp/bsp_capture.h"
+#include "bsp/bsp_debounce.h"
+#include "bsp/bsp_icap.h"
+#include "bsp/bsp_sched.h"
+#include "bsp/bsp_wdg.h"
+#include "bsp/bsp_work.h"
+
+#include <stdio.h>
+
+/* The template used to base the priorities on BSP_IRQPRIO_MAX */
+#if BSP_IRQPRIO_SYSTICK == BSP_IRQPRIO_MAX && \
+    BSP_IRQPRIO_EXTI == BSP_IRQPRIO_MAX + 1 && \
+    BSP_IRQPRIO_TTY == BSP_IRQPRIO_MAX + 2
+#error bsp_config.h is based on an outdated template, replace BSP_IRQPRIO_MAX by BSP_IRQPRIO_CRITICAL in the BSP_IRQPRIO_x definitions, see README.md
+#endif
+
+/**
+ * @brief Checks a interrupt priority of the bsp against the priority plan, 
+ * it has to be masked by bspCriticalEnter() and may call interrupt safe 
+ * FreeRTOS functions.
+ */
+static constexpr bool bspIrqPrioValid(uint32_t prio)
+{
+    return prio >= BSP_IRQPRIO_CRITICAL && 
+        prio >= BSP_IRQPRIO_FREERTOS_SYSCALL && prio <= BSP_IRQPRIO_MIN;
+}
+
+static_assert(BSP_IRQPRIO_FREERTOS_SYSCALL > BSP_IRQPRIO_MAX && 
+    BSP_IRQPRIO_FREERTOS_SYSCALL <= BSP_IRQPRIO_MIN,
+    "BSP_IRQPRIO_FREERTOS_SYSCALL out of range, BASEPRI can not mask 0");
+static_assert(BSP_IRQPRIO_CRITICAL <= BSP_IRQPRIO_MIN,
+    "BSP_IRQPRIO_CRITICAL out of range");
+static_assert(bspIrqPrioValid(BSP_IRQPRIO_TTY), "Invalid BSP_IRQPRIO_TTY");
+static_assert(bspIrqPrioValid(BSP_IRQPRIO_EXTI), "Invalid BSP_IRQPRIO_EXTI");
+
+#if BSP_SYSTICK == BSP_ENABLED
+
+static_assert(bspIrqPrioValid(BSP_IRQPRIO_SYSTICK), 
+    "Invalid BSP_IRQPRIO_SYSTICK");
+static_assert(BSP_IRQPRIO_SYSTICK <= BSP_IRQPRIO_TTY,
+    "The sys tick must not be delayed by the tty");
+
+#endif /* BSP_SYSTICK == BSP_ENABLED */
+
+
+#if BSP_PROF == BSP_ENABLED && BSP_PROF_TIMER == BSP_ENABLED
+
+static_assert(bspIrqPrioValid(BSP_IRQPRIO_PROF), "Invalid BSP_IRQPRIO_PROF");
+
+#endif /* BSP_PROF == BSP_ENABLED && BSP_PROF_TIMER == BSP_ENABLED */
+
+#if BSP_WAVE == BSP_ENABLED
+
+static_assert(bspIrqPrioValid(BSP_IRQPRIO_WAVE), "Invalid BSP_IRQPRIO_WAVE");
+static_assert(BSP_IRQPRIO_WAVE <= BSP_IRQPRIO_TTY,
+    "The waveform refill must not be delayed by the tty");
+
+#endif /* BSP_WAVE == BSP_ENABLED */
+
+#if BSP_CAPTURE == BSP_ENABLED
+
+static_assert(bspIrqPrioValid(BSP_IRQPRIO_CAPTURE), 
+    "Invalid BSP_IRQPRIO_CAPTURE");
+static_assert(BSP_IRQPRIO_CAPTURE <= BSP_IRQPRIO_TTY,
+    "The capture drain must not be delayed by the tty");
+
+#endif /* BSP_CAPTURE == BSP_ENABLED */
+
+#if BSP_ICAP == BSP_ENABLED
+
+static_assert(bspIrqPrioValid(BSP_IRQPRIO_ICAP), "Invalid BSP_IRQPRIO_ICAP");
+static_assert(BSP_IRQPRIO_ICAP <= BSP_IRQPRIO_TTY,
+    "The capture meter must not be delayed by the tty");
+
+#endif /* BSP_ICAP == BSP_ENABLED */
+
+#if BSP_DMA_M2M == BSP_ENABLED
+
+static_assert(bspIrqPrioValid(BSP_IRQPRIO_DMA_M2M), 
+    "Invalid BSP_IRQPRIO_DMA_M2M");
+
+#endif /* BSP_DMA_M2M == BSP_ENABLED */
+
+#if BSP_SCHED == BSP_ENABLED
+
+static_assert(BSP_SCHED_LEVELS < 2 || (bspIrqPrioValid(BSP_IRQPRIO_SCHED) &&
+    bspIrqPrioValid(BSP_IRQPRIO_SCHED + BSP_SCHED_LEVELS - 2)), 
+    "Invalid BSP_IRQPRIO_SCHED, all levels need a valid priority");
+
+#endif /* BSP_SCHED == BSP_ENABLED */
 
 inline bool bspIsInterrupt(void)
 {
@@ -43,9 +142,78 @@ inline bool bspIsInterrupt(void)
  */
 volatile uint32_t sysTick = 0;
 
-extern "C" void SysTick_Handler(void)
+#if BSP_PROF_SYSTICK
+
+/**
+ * @brief The profiler needs the stack frame of the interrupted context.
+ */
+BSP_EXC_FRAME_HANDLER(SysTick_Handler, bspSysTickIsr)
+
+extern "C" BSP_RAMFUNC_ISR void bspSysTickIsr(bspExcFrame_t *pFrame)
+
+#else /* BSP_PROF_SYSTICK */
+
+extern "C" BSP_RAMFUNC_ISR void SysTick_Handler(void)
+
+#endif /* BSP_PROF_SYSTICK */
 {
+    BSP_ISR_ENTER(BSP_ISR_SYSTICK);
+
+    /* The counter runs on the core clock, so the cycles since it has reached
+     * zero are the entry latency */
+    BSP_ISR_LATENCY(BSP_ISR_SYSTICK, SysTick->LOAD - SysTick->VAL);
+
     sysTick++;
+
+#if BSP_DEBOUNCE == BSP_ENABLED
+
+    bspDebounceTick();
+
+#endif /* BSP_DEBOUNCE == BSP_ENABLED */
+
+#if BSP_SCHED == BSP_ENABLED
+
+    bspSchedTick();
+
+#endif /* BSP_SCHED == BSP_ENABLED */
+
+#if BSP_WDG == BSP_ENABLED
+
+    bspWdgTick();
+
+#endif /* BSP_WDG == BSP_ENABLED */
+
+#if BSP_PROF_SYSTICK
+
+    bspProfSample(pFrame);
+
+#endif /* BSP_PROF_SYSTICK */
+
+#if BSP_RTOS == BSP_ENABLED
+
+    /* The port handler must not run before the scheduler has been started */
+    if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED)
+    {
+        static bool prioRestored = false;
+        uint32_t basePri = __get_BASEPRI();
+
+        /* xPortStartScheduler() moves the sys tick to the lowest priority */
+        if (!prioRestored)
+        {
+            NVIC_SetPriority(SysTick_IRQn, BSP_IRQPRIO_SYSTICK);
+            prioRestored = true;
+        }
+
+        /* The port handler clears BASEPRI on exit, as it expects to run at
+         * the lowest priority. BASEPRI is not stacked, so it is restored
+         * here for a preempted bspCriticalEnterPrio() section */
+        xPortSysTickHandler();
+        __set_BASEPRI(basePri);
+    }
+
+#endif /* BSP_RTOS == BSP_ENABLED */
+
+    BSP_ISR_EXIT(BSP_ISR_SYSTICK);
 }
 
 uint32_t bspGetSysTick(void)
@@ -55,6 +223,20 @@ uint32_t bspGetSysTick(void)
 
 void bspDelayMs(uint32_t delay)
 {
+#if BSP_RTOS == BSP_ENABLED
+
+    if (bspRtosCanBlock())
+    {
+        /* Add a period to guarantee minimum wait */
+        if (delay < BSP_MAX_DELAY)
+            delay++;
+
+        vTaskDelay(pdMS_TO_TICKS(delay));
+        return;
+    }
+
+#endif /* BSP_RTOS == BSP_ENABLED */
+
     uint32_t tickstart = bspGetSysTick();
 
     /* Add a period to guarantee minimum wait */
@@ -66,53 +248,86 @@ void bspDelayMs(uint32_t delay)
 
 #endif /* BSP_SYSTICK == BSP_ENABLED */
 
+#if BSP_VECT_RAM == BSP_ENABLED
+
 /**
- * @brief All clock´s shall be managed here to keep the big picture.
+ * @brief The vector table in SRAM, VTOR needs an alignment to the table size
+ * rounded up to the next power of two.
  */
-static inline void bspClockInit(void)
-{
-    int clk = 0;
-
-    LL_FLASH_SetLatency(LL_FLASH_LATENCY_3);
+static void (*vectTable[BSP_VECT_NUM])(void) __attribute__((aligned(512)));
 
-#ifndef BSP_CLOCKSRC_HSI
+static_assert(sizeof(vectTable) <= 512, "Alignment of vectTable too small");
 
-    LL_RCC_HSE_EnableBypass();
-    LL_RCC_HSE_Enable();
-    
-    while(LL_RCC_HSE_IsReady() != 1);
+/**
+ * @brief Copies the current vector table to SRAM and switches to it.
+ */
+static inline void bspVectInit(void)
+{
+    void (**pVect)(void) = (void (**)(void)) SCB->VTOR;
+    uint32_t crit = bspCriticalEnter();
 
-    LL_RCC_PLL_ConfigDomain_SYS(
-        LL_RCC_PLLSOURCE_HSE, LL_RCC_PLLM_DIV_8, 400, LL_RCC_PLLP_DIV_4);
-    clk = 100000000;
+    for (uint32_t i = 0; i < BSP_VECT_NUM; i++)
+        vectTable[i] = pVect[i];
 
-#else
+    __DSB();
+    SCB->VTOR = (uint32_t) vectTable;
+    __DSB();
+    __ISB();
 
-    #error HSI not supported so far.
+    bspCriticalExit(crit);
+}
 
-#endif
+void bspSetVector(IRQn_Type irq, void (*handler)(void))
+{
+    vectTable[16 + irq] = handler;
+    __DSB();
+}
 
-    LL_RCC_PLL_Enable();
-    while(LL_RCC_PLL_IsReady() != 1);
+#endif /* BSP_VECT_RAM == BSP_ENABLED */
 
-    LL_RCC_SetAHBPrescaler(LL_RCC_SYSCLK_DIV_1);
-    LL_RCC_SetSysClkSource(LL_RCC_SYS_CLKSOURCE_PLL);
-    while(LL_RCC_GetSysClkSource() != LL_RCC_SYS_CLKSOURCE_STATUS_PLL);
+#if BSP_FLASH_ART == BSP_ENABLED
 
-    LL_RCC_SetAPB1Prescaler(LL_RCC_APB1_DIV_2);
-    LL_RCC_SetAPB2Prescaler(LL_RCC_APB2_DIV_1);
+/**
+ * @brief Enables the ART accelerator and the prefetch buffer.
+ */
+static inline void bspFlashInit(void)
+{
+    /* The caches may only be reset while disabled */
+    LL_FLASH_DisableInstCache();
+    LL_FLASH_DisableDataCache();
+    LL_FLASH_EnableInstCacheReset();
+    LL_FLASH_EnableDataCacheReset();
+    LL_FLASH_DisableInstCacheReset();
+    LL_FLASH_DisableDataCacheReset();
+
+    LL_FLASH_EnableInstCache();
+    LL_FLASH_EnableDataCache();
+    LL_FLASH_EnablePrefetch();
+}
 
-    LL_SetSystemCoreClock(clk);
+#endif /* BSP_FLASH_ART == BSP_ENABLED */
 
-    LL_Init1msTick(clk);
+/**
+ * @brief All clock´s shall be managed here to keep the big picture.
+ */
+static inline void bspClockInit(void)
+{
+    /* Needed for the voltage scaling and over-drive */
+    LL_APB1_GRP1_EnableClock(LL_APB1_GRP1_PERIPH_PWR);
 
 #if BSP_SYSTICK == BSP_ENABLED
 
-    SysTick->CTRL  |= SysTick_CTRL_TICKINT_Msk;
+    /* Before the tick interrupt gets enabled by bspClockSetProfile() */
     NVIC_SetPriority(SysTick_IRQn, BSP_IRQPRIO_SYSTICK);
 
 #endif /* BSP_SYSTICK == BSP_ENABLED */
 
+    /* HSE with a bounded wait or the HSI as fallback */
+    bspClockStart();
+
+    /* PLL, flash wait states, bus prescalers and sys tick reload value */
+    bspClockSetProfile(BSP_CLOCK_PROFILE);
+
     /* For external interrupts we need SYSCFG */
     LL_APB2_GRP1_EnableClock(LL_APB2_GRP1_PERIPH_SYSCFG); 
 
@@ -120,10 +335,134 @@ static inline void bspClockInit(void)
     LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_DMA1);
 
     TTY_USARTx_CLK_ENABLE();
+
+#if BSP_PROF == BSP_ENABLED && BSP_PROF_TIMER == BSP_ENABLED
+
+    /* Profiler sample timer */
+    LL_APB1_GRP1_EnableClock(LL_APB1_GRP1_PERIPH_TIM7);
+
+#endif
+
+#if BSP_WAVE == BSP_ENABLED || BSP_CAPTURE == BSP_ENABLED || \
+    BSP_DMA_M2M == BSP_ENABLED
+
+    /* DMA2 is used by the waveform engine, the port sampler and memory to 
+     * memory transfers */
+    LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_DMA2);
+
+#endif
+
+#if BSP_WAVE == BSP_ENABLED
+
+    /* Waveform engine, TIM8 update events trigger DMA2 */
+    LL_APB2_GRP1_EnableClock(LL_APB2_GRP1_PERIPH_TIM8);
+
+#endif
+
+#if BSP_CAPTURE == BSP_ENABLED
+
+    /* Port sampler, TIM1 update events trigger DMA2 */
+    LL_APB2_GRP1_EnableClock(LL_APB2_GRP1_PERIPH_TIM1);
+
+#endif
+
+#if BSP_ICAP == BSP_ENABLED
+
+    /* Input capture meter */
+    LL_APB1_GRP1_EnableClock(LL_APB1_GRP1_PERIPH_TIM5);
+
+#endif
+}
+
+uint32_t bspGetTimClock(TIM_TypeDef *pTim)
+{
+    uint32_t hclk = __LL_RCC_CALC_HCLK_FREQ(
+        SystemCoreClock, LL_RCC_GetAHBPrescaler());
+
+    /* Timers run at twice the bus clock if the APB prescaler is not 1 */
+    if ((uint32_t) pTim >= APB2PERIPH_BASE)
+    {
+        if (LL_RCC_GetAPB2Prescaler() == LL_RCC_APB2_DIV_1)
+            return hclk;
+
+        return 2 * __LL_RCC_CALC_PCLK2_FREQ(hclk, LL_RCC_GetAPB2Prescaler());
+    }
+
+    if (LL_RCC_GetAPB1Prescaler() == LL_RCC_APB1_DIV_1)
+        return hclk;
+
+    return 2 * __LL_RCC_CALC_PCLK1_FREQ(hclk, LL_RCC_GetAPB1Prescaler());
+}
+
+uint32_t bspTimSetRate(TIM_TypeDef *pTim, uint32_t rateHz)
+{
+    uint32_t clk = bspGetTimClock(pTim);
+    uint32_t div = clk / rateHz;
+    uint32_t psc = div / 0x10000;
+    uint32_t arr = (div / (psc + 1)) - 1;
+
+    LL_TIM_SetPrescaler(pTim, psc);
+    LL_TIM_SetAutoReload(pTim, arr);
+    LL_TIM_GenerateEvent_UPDATE(pTim);
+    LL_TIM_ClearFlag_UPDATE(pTim);
+
+    return clk / ((psc + 1) * (arr + 1));
+}
+
+void bspCycleCounterInit(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
 }
 
+/**
+ * @brief The duration of bspChipInit() in us.
+ */
+static uint32_t initTime = 0;
+
 void bspChipInit(void)
 {
+    /* Needed for time measurements */
+    bspCycleCounterInit();
+
+    /* Before any priority is set */
+    NVIC_SetPriorityGrouping(BSP_IRQ_PRIOGROUP);
+
+#if BSP_EVLOG == BSP_ENABLED
+
+    /* Before bspCrashInit() clears the reset flags */
+    bspEvLogInit();
+
+#endif /* BSP_EVLOG == BSP_ENABLED */
+
+#if BSP_CRASH == BSP_ENABLED
+
+    /* As early as possible to catch faults during the initialization */
+    bspCrashInit();
+
+#endif /* BSP_CRASH == BSP_ENABLED */
+
+#if BSP_VECT_RAM == BSP_ENABLED
+
+    /* Before any interrupt is enabled */
+    bspVectInit();
+
+#endif /* BSP_VECT_RAM == BSP_ENABLED */
+
+#if BSP_FLASH_ART == BSP_ENABLED
+
+    /* Before the wait states are raised by bspClockInit() */
+    bspFlashInit();
+
+#endif /* BSP_FLASH_ART == BSP_ENABLED */
+
+#if BSP_ISR_STATS == BSP_ENABLED
+
+    bspIsrStatReset();
+
+#endif /* BSP_ISR_STATS == BSP_ENABLED */
+
     /* Turn on all need clocks at once */
     bspClockInit();
 
@@ -133,8 +472,103 @@ void bspChipInit(void)
     /* Configure the tty */
     bspTTYInit(BSP_TTY_BAUDRATE);
 
+#if BSP_FAST_BOOT != BSP_ENABLED
+
+    bspChipInitDeferred();
+
+#endif /* BSP_FAST_BOOT != BSP_ENABLED */
+
+    /* Up to the clock switch the core has been running from the HSI */
+    initTime = bspClockGetSwitchCycle() / (BSP_HSI_HZ / 1000000) + 
+        (bspGetCycleCount() - bspClockGetSwitchCycle()) / 
+        (SystemCoreClock / 1000000);
+
+#if BSP_CLOCKSRC_HSI != BSP_ENABLED
+
+    if (bspClockGetSource() != BSP_CLOCK_SRC_HSE)
+        printf("bsp: HSE not ready, running from HSI\n");
+
+#endif /* BSP_CLOCKSRC_HSI != BSP_ENABLED */
+
+#if BSP_CRASH == BSP_ENABLED
+
+    bspCrashReport();
+
+#endif /* BSP_CRASH == BSP_ENABLED */
+
+#if BSP_EVLOG == BSP_ENABLED && BSP_EVLOG_BOOT_DUMP == BSP_ENABLED
+
+    bspEvLogDump();
+
+#endif /* BSP_EVLOG == BSP_ENABLED && BSP_EVLOG_BOOT_DUMP == BSP_ENABLED */
+
+#if BSP_WDG == BSP_ENABLED
+
+    /* Once the reports are out, they may take longer than the timeout */
+    bspWdgInit();
+
+#endif /* BSP_WDG == BSP_ENABLED */
+}
+
+void bspChipInitDeferred(void)
+{
+#if BSP_WORK == BSP_ENABLED
+
+    /* Before any interrupt which may post work */
+    bspWorkInit();
+
+#endif /* BSP_WORK == BSP_ENABLED */
+
+#if BSP_SCHED == BSP_ENABLED
+
+    bspSchedInit();
+
+#endif /* BSP_SCHED == BSP_ENABLED */
+
+#if BSP_DMA_M2M == BSP_ENABLED
+
+    bspDmaM2MInit();
+
+#endif /* BSP_DMA_M2M == BSP_ENABLED */
+
+#if BSP_DEBOUNCE == BSP_ENABLED
+
+    /* Before the external interrupts as it might take over the button */
+    bspDebounceInit();
+
+#endif /* BSP_DEBOUNCE == BSP_ENABLED */
+
     /* External interrupts (Button)*/
     bspExtiInit();
+
+#if BSP_PROF == BSP_ENABLED
+
+    bspProfInit();
+
+#endif /* BSP_PROF == BSP_ENABLED */
+
+#if BSP_WAVE == BSP_ENABLED
+
+    bspWaveInit();
+
+#endif /* BSP_WAVE == BSP_ENABLED */
+
+#if BSP_CAPTURE == BSP_ENABLED
+
+    bspCaptureInit();
+
+#endif /* BSP_CAPTURE == BSP_ENABLED */
+
+#if BSP_ICAP == BSP_ENABLED
+
+    bspIcapInit();
+
+#endif /* BSP_ICAP == BSP_ENABLED */
+}
+
+uint32_t bspGetInitTime(void)
+{
+    return initTime;
 }
 
 void bspResetCpu(void)
@@ -40,6 +40,17 @@
 #define BSP_GPIO_C13                        BSP_GPIO_BUTTON
 #endif
 
+#if BSP_ICAP == BSP_ENABLED
+
+/**
+ * @brief Input of the capture meter, TIM5_CH1 see bsp_icap.h.
+ */
+#ifndef BSP_GPIO_A0
+#define BSP_GPIO_A0                         BSP_GPIO_ICAP
+#endif
+
+#endif /* BSP_ICAP == BSP_ENABLED */
+
 /**
  * @brief Definitions of external interrupt lines.
  */
@@ -60,66 +71,10 @@
 #define TTY_USARTx_IRQHandler               USART2_IRQHandler
 
 /**
- * @brief Hence that the DMA channel to use is hard coded by ST.
- * See DMA channel assignment table below. 
- */
-#define TTY_TXDMA_STR                       LL_DMA_STREAM_6
-#define TTY_TXDMA_CH                        LL_DMA_CHANNEL_4
-#define TTY_TXDMA_STR_IRQn                  DMA1_Stream6_IRQn
-#define TTY_TXDMA_STR_IRQHandler            DMA1_Stream6_IRQHandler
-#define TTY_TXDMACH_ISACTIVEFLAG_TC()       LL_DMA_IsActiveFlag_TC6(DMA1)
-#define TTY_TXDMACH_CLEARFLAG_TC()          LL_DMA_ClearFlag_TC6(DMA1)
-
-/**
- * @brief DMA channel assignment from ST.
- * 
- * Please enote that this hard coded and can not be changed!
+ * @brief The tty tx DMA request, USART2_TX on DMA1 Stream6 Channel4. See 
+ * bsp_dma.h for the mapping of all requests.
  */
-#define BSP_DMACH_ADC1                      DMA1_Channel1
-
-#define BSP_DMACH_SPI1_TX                   DMA1_Channel3
-#define BSP_DMACH_SPI1_RX                   DMA1_Channel2
-#define BSP_DMACH_SPI2_TX                   DMA1_Channel5
-#define BSP_DMACH_SPI2_RX                   DMA1_Channel4
-
-#define BSP_DMACH_USART1_TX                 DMA1_Channel4
-#define BSP_DMACH_USART1_RX                 DMA1_Channel5
-#define BSP_DMACH_USART2_TX                 DMA1_Channel7
-#define BSP_DMACH_USART2_RX                 DMA1_Channel6
-#define BSP_DMACH_USART3_TX                 DMA1_Channel2
-#define BSP_DMACH_USART3_RX                 DMA1_Channel3
-
-#define BSP_DMACH_I2C1_TX                   DMA1_Channel6
-#define BSP_DMACH_I2C1_RX                   DMA1_Channel7
-#define BSP_DMACH_I2C2_TX                   DMA1_Channel4
-#define BSP_DMACH_I2C2_RX                   DMA1_Channel5
-
-#define BSP_DMACH_TIM1_CH1                  DMA1_Channel2
-#define BSP_DMACH_TIM1_CH3                  DMA1_Channel6
-#define BSP_DMACH_TIM1_CH4                  DMA1_Channel4
-#define BSP_DMACH_TIM1_UP                   DMA1_Channel5
-#define BSP_DMACH_TIM1_TRIG                 DMA1_Channel4
-#define BSP_DMACH_TIM1_COM                  DMA1_Channel4
-
-#define BSP_DMACH_TIM2_CH1                  DMA1_Channel5
-#define BSP_DMACH_TIM2_CH2                  DMA1_Channel7
-#define BSP_DMACH_TIM2_CH3                  DMA1_Channel1
-#define BSP_DMACH_TIM2_CH4                  DMA1_Channel7
-#define BSP_DMACH_TIM2_UP                   DMA1_Channel2
-
-#define BSP_DMACH_TIM3_CH1                  DMA1_Channel6
-#define BSP_DMACH_TIM3_CH3                  DMA1_Channel2
-#define BSP_DMACH_TIM3_CH4                  DMA1_Channel3
-#define BSP_DMACH_TIM3_UP                   DMA1_Channel3
-#define BSP_DMACH_TIM3_TRIG                 DMA1_Channel6
-
-#define BSP_DMACH_TIM4_CH1                  DMA1_Channel1
-#define BSP_DMACH_TIM4_CH2                  DMA1_Channel4
-#define BSP_DMACH_TIM4_CH3                  DMA1_Channel5
-#define BSP_DMACH_TIM4_UP                   DMA1_Channel7
-
-#define BSP_DMAIRQn(_ch)                    _ch##_IRQn
-#define BSP_DMAIRQHandler(_ch)              _ch##_IRQHandler
+#define TTY_TXDMA_REQ                       BSP_DMA_REQ_USART2_TX
 
 #ifndef __NVIC_PRIO_BITS
 
@@ -152,10 +107,31 @@
 
 /**
  * @brief The lowest interrupt priority that can be used in a call to a
- * NVIC_SetPriority() function. Given by the fact that there are only
- * tree priority bits.
+ * NVIC_SetPriority() function. Given by the number of implemented priority
+ * bits, four on the STM32F446.
+ */
+#define BSP_IRQPRIO_MIN                     ((1UL << __NVIC_PRIO_BITS) - 1)
+
+/**
+ * @brief The priority grouping set by bspChipInit(), all priority bits are
+ * used for preemption and none for sub priorities. Hence that FreeRTOS 
+ * relies on this and that the BSP_IRQPRIO_x values are passed as they are
+ * to NVIC_SetPriority().
+ */
+#define BSP_IRQ_PRIOGROUP                   (7 - __NVIC_PRIO_BITS)
+
+#ifndef BSP_IRQPRIO_CRITICAL
+
+/**
+ * @brief The highest priority masked by bspCriticalEnter(), interrupts with
+ * a higher priority are never delayed by critical sections of the bsp. 
+ * 
+ * All interrupts of the bsp have to use this or a lower priority, see 
+ * bsp_config.h.
  */
-#define BSP_IRQPRIO_MIN                     0x07
+#define BSP_IRQPRIO_CRITICAL                BSP_IRQPRIO_FREERTOS_SYSCALL
+
+#endif
 
 /**
  * @brief Generic type used as return value for public BSP functions where 
@@ -208,6 +184,228 @@ void bspDelayMs(uint32_t delay);
 
 #endif /* BSP_SYSTICK == BSP_ENABLED */
 
+/**
+ * @brief Used to enable the DWT cycle counter of the core.
+ * 
+ * Called by bspChipInit(), the counter is free running afterwards and wraps
+ * around after 2^32 cycles.
+ */
+void bspCycleCounterInit(void);
+
+/**
+ * @brief Used to read the DWT cycle counter.
+ * 
+ * @return  The current number of core clock cycles.
+ */
+static inline uint32_t bspGetCycleCount(void)
+{
+    return DWT->CYCCNT;
+}
+
+/**
+ * @brief Used to enter a critical section which masks all interrupts with 
+ * the given or a lower priority.
+ * 
+ * Sections can be nested as BASEPRI is only ever raised, the state returned
+ * has to be passed to bspCriticalExit(). Hence that BASEPRI can not mask 
+ * priority BSP_IRQPRIO_MAX, PRIMASK is used in this case.
+ * 
+ * @param prio      The highest priority to mask.
+ * 
+ * @return  The previous BASEPRI and PRIMASK.
+ */
+__attribute__((always_inline)) static inline uint32_t bspCriticalEnterPrio(
+    uint32_t prio)
+{
+    uint32_t state = __get_BASEPRI() | (__get_PRIMASK() << 8);
+
+    if (prio == BSP_IRQPRIO_MAX)
+        __disable_irq();
+    else
+        __set_BASEPRI_MAX(prio << (8 - __NVIC_PRIO_BITS));
+
+    __DSB();
+    __ISB();
+
+    return state;
+}
+
+/**
+ * @brief Used to enter a critical section which masks all interrupts up to
+ * BSP_IRQPRIO_CRITICAL, see bspCriticalEnterPrio().
+ * 
+ * @return  The state to pass to bspCriticalExit().
+ */
+__attribute__((always_inline)) static inline uint32_t bspCriticalEnter(void)
+{
+    return bspCriticalEnterPrio(BSP_IRQPRIO_CRITICAL);
+}
+
+/**
+ * @brief Used to leave a critical section.
+ * 
+ * @param state     The value returned by the matching enter call.
+ */
+__attribute__((always_inline)) static inline void bspCriticalExit(
+    uint32_t state)
+{
+    __set_BASEPRI(state & 0xFF);
+    __set_PRIMASK(state >> 8);
+}
+
+/**
+ * @brief Used to enable a interrupt, the priority is set before so the 
+ * interrupt never runs at the reset default priority BSP_IRQPRIO_MAX.
+ * 
+ * @param irq       The interrupt.
+ * @param prio      The priority, one of the BSP_IRQPRIO_x values.
+ */
+static inline void bspIrqEnable(IRQn_Type irq, uint32_t prio)
+{
+    NVIC_SetPriority(irq, prio);
+    NVIC_EnableIRQ(irq);
+}
+
+/**
+ * @brief Keeps a critical section as long as the object lives.
+ */
+class BspCriticalScope
+{
+    public:
+
+        __attribute__((always_inline)) BspCriticalScope(
+            uint32_t prio = BSP_IRQPRIO_CRITICAL) : 
+            State(bspCriticalEnterPrio(prio))
+        {
+
+        }
+
+        __attribute__((always_inline)) ~BspCriticalScope()
+        {
+            bspCriticalExit(State);
+        }
+
+    private:
+
+        const uint32_t State;
+};
+
+/**
+ * @brief Masks all interrupts up to BSP_IRQPRIO_CRITICAL until the end of 
+ * the current scope.
+ */
+#define BSP_CRITICAL_SCOPE()                BspCriticalScope _criticalScope
+
+/**
+ * @brief The registers stacked by the core on exception entry.
+ */
+typedef struct
+{
+    uint32_t R0;
+    uint32_t R1;
+    uint32_t R2;
+    uint32_t R3;
+    uint32_t R12;
+    uint32_t Lr;
+    uint32_t Pc;
+    uint32_t Psr;
+
+} bspExcFrame_t;
+
+/**
+ * @brief Used to implement the exception handler _vector as naked entry which
+ * passes the stack frame of the interrupted context to _handler. 
+ * 
+ * _handler has to be declared as extern "C" void _handler(bspExcFrame_t *).
+ * Hence that it is entered by a branch and returns with the untouched
+ * EXC_RETURN value in lr. It is marked as used as it is only referenced by
+ * the inline assembly, which is not seen by the optimizer or LTO.
+ */
+#define BSP_EXC_FRAME_HANDLER(_vector, _handler)                            \
+                                                                            \
+    extern "C" void _handler(bspExcFrame_t *pFrame) __attribute__((used));  \
+                                                                            \
+    extern "C" __attribute__((naked)) void _vector(void)                    \
+    {                                                                       \
+        __asm volatile(                                                     \
+            "tst    lr, #4          \n"                                     \
+            "ite    eq              \n"                                     \
+            "mrseq  r0, msp         \n"                                     \
+            "mrsne  r0, psp         \n"                                     \
+            "b      " #_handler "   \n");                                   \
+    }
+
+/**
+ * @brief Used to place a function in SRAM to run it without flash wait 
+ * states.
+ * 
+ * The .RamFunc section is copied to SRAM together with .data by the startup
+ * code of the STM32Cube linker scripts, custom linker scripts have to list 
+ * *(.RamFunc) and *(.RamFunc*) in the .data output section. Hence that calls
+ * from and to flash need long branch veneers which are inserted by the 
+ * linker.
+ */
+#define BSP_RAMFUNC                         __attribute__((section(".RamFunc"), noinline))
+
+#if BSP_ISR_RAM == BSP_ENABLED
+
+/**
+ * @brief Used on the time critical interrupt handlers of the bsp.
+ */
+#define BSP_RAMFUNC_ISR                     BSP_RAMFUNC
+
+#else /* BSP_ISR_RAM == BSP_ENABLED */
+
+/**
+ * @brief Empty declaration as handlers shall stay in flash.
+ */
+#define BSP_RAMFUNC_ISR
+
+#endif /* BSP_ISR_RAM == BSP_ENABLED */
+
+#if BSP_VECT_RAM == BSP_ENABLED
+
+/**
+ * @brief Number of entries in the vector table, 16 core exceptions and all
+ * interrupts of the STM32F446.
+ */
+#define BSP_VECT_NUM                        (16 + FMPI2C1_ER_IRQn + 1)
+
+/**
+ * @brief Used to install a interrupt handler in the vector table in SRAM.
+ * 
+ * @param irq       The interrupt, negative values are core exceptions.
+ * @param handler   The handler.
+ */
+void bspSetVector(IRQn_Type irq, void (*handler)(void));
+
+#endif /* BSP_VECT_RAM == BSP_ENABLED */
+
+/**
+ * @brief Used to get the input clock of the given timer, which depends on
+ * the APB prescaler of the bus the timer is connected to.
+ *
+ * @param pTim  The timer.
+ *
+ * @return  The timer clock in Hz.
+ */
+uint32_t bspGetTimClock(TIM_TypeDef *pTim);
+
+/**
+ * @brief Used to set the update rate of the given timer.
+ *
+ * The prescaler and auto reload values are loaded right away by a update
+ * event, the update flag is cleared afterwards. Hence that the divider is
+ * rounded down, so the achieved rate is greater than or equal to the 
+ * requested one, use the return value to get the actual rate.
+ *
+ * @param pTim      The timer.
+ * @param rateHz    The update rate in Hz, 1 to half the timer clock.
+ *
+ * @return  The achieved rate in Hz.
+ */
+uint32_t bspTimSetRate(TIM_TypeDef *pTim, uint32_t rateHz);
+
 /**
  * @brief Used to check if the current code is executed in the context of a 
  * interrupt.
@@ -218,9 +416,35 @@ bool bspInInterrupt(void);
 
 /**
  * @brief Used to implement generic chip initialization
+ * 
+ * If BSP_FAST_BOOT is enabled only the clocks, the pins and the tty are 
+ * initialized, the remaining modules have to be initialized by calling 
+ * bspChipInitDeferred() later on.
  */
 void bspChipInit(void);
 
+/**
+ * @brief Used to initialize all bsp modules which are not needed to bring 
+ * up the core and the tty, e.g. external interrupts, profiler, waveform 
+ * engine etc. 
+ * 
+ * Called by bspChipInit() unless BSP_FAST_BOOT is enabled.
+ */
+void bspChipInitDeferred(void);
+
+/**
+ * @brief Used to get the time spent in bspChipInit().
+ * 
+ * Hence that this is not the time from reset to main(). The startup code 
+ * which copies .data, clears .bss and runs the static constructors is not
+ * included, as the cycle counter is enabled by bspChipInit(). The cycles 
+ * up to the switch to the target clock are counted at the HSI frequency, 
+ * see bspClockGetSwitchCycle().
+ * 
+ * @return  The time in us.
+ */
+uint32_t bspGetInitTime(void);
+
 /**
  * @brief used to trigger a CPU reset.
  */
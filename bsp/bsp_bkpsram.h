@@ -0,0 +1,102 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+
+#ifndef BSP_NUCLEO_F446_BKPSRAM_H_
+#define BSP_NUCLEO_F446_BKPSRAM_H_
+
+#include "bsp/bsp.h"
+#include "bsp/bsp_evlog.h"
+
+#include <stdint.h>
+
+/**
+ * Backup SRAM.
+ * 
+ * The 4k backup SRAM is neither touched by a reset nor by the startup code,
+ * so it keeps its content as long as VDD is present, or VBAT if
+ * BSP_BKPSRAM_VBAT is enabled. It is divided into fixed regions, one for each
+ * bsp module using it, the rest is free for the application.
+ */
+
+/**
+ * @brief Size of the backup SRAM in bytes.
+ */
+#define BSP_BKPSRAM_SIZE                    4096
+
+/**
+ * @brief The region of the crash record, see bsp_crash.h.
+ */
+#define BSP_BKPSRAM_CRASH_OFS               0
+#define BSP_BKPSRAM_CRASH_SIZE              256
+
+/**
+ * @brief The region of the event log, see bsp_evlog.h.
+ */
+#define BSP_BKPSRAM_EVLOG_OFS               (BSP_BKPSRAM_CRASH_OFS + \
+                                             BSP_BKPSRAM_CRASH_SIZE)
+#if BSP_EVLOG == BSP_ENABLED
+#define BSP_BKPSRAM_EVLOG_SIZE              (16 + 12 * BSP_EVLOG_SIZE)
+#else
+#define BSP_BKPSRAM_EVLOG_SIZE              0
+#endif
+
+/**
+ * @brief The region free for the application.
+ */
+#define BSP_BKPSRAM_APP_OFS                 (BSP_BKPSRAM_EVLOG_OFS + \
+                                             BSP_BKPSRAM_EVLOG_SIZE)
+#define BSP_BKPSRAM_APP_SIZE                (BSP_BKPSRAM_SIZE - \
+                                             BSP_BKPSRAM_APP_OFS)
+
+/**
+ * @brief Used to enable the clock of and write access to the backup SRAM.
+ * 
+ * Can be called from any context, also from fault handlers. If
+ * BSP_BKPSRAM_VBAT is enabled the backup regulator is turned on as well.
+ */
+void bspBkpSramInit(void);
+
+/**
+ * @brief Used to get the address of the given offset in the backup SRAM.
+ *
+ * @param ofs       The offset in bytes.
+ *
+ * @return  The address.
+ */
+static inline void *bspBkpSramAddr(uint32_t ofs)
+{
+    return (void *)(BKPSRAM_BASE + ofs);
+}
+
+/**
+ * @brief Used to compute a CRC-32 (IEEE 802.3) to validate records kept in
+ * the backup SRAM.
+ *
+ * @param pData     The data.
+ * @param len       The number of bytes.
+ *
+ * @return  The CRC.
+ */
+uint32_t bspBkpSramCrc(const void *pData, uint32_t len);
+
+#endif /* BSP_NUCLEO_F446_BKPSRAM_H_ */
@@ -0,0 +1,208 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+#ifndef BSP_NUCLEO_F446_CAPTURE_H_
+#define BSP_NUCLEO_F446_CAPTURE_H_
+
+#include "bsp/bsp.h"
+#include "bsp/bsp_gpio.h"
+
+#include <stdint.h>
+
+/**
+ * DMA gpio port sampler.
+ *
+ * Copies the IDR register of a gpio port to a buffer, one halfword per 
+ * update event of TIM1. The transfers are done by DMA2 Stream5 Channel6 
+ * (TIM1_UP), so the sample timing only depends on the timer. 
+ * 
+ * In trigger mode the port is sampled continuously into a circular buffer 
+ * until bspCaptureTrigger() is called, e.g. on a edge by passing 
+ * bspCaptureExtiCb() to bspExtiAttach(), and stopped once the post trigger 
+ * samples have been taken. The result is a 
+ * window of the samples around the trigger, see bspCaptureGetWindow().
+ * 
+ * Hence that the pins to sample have to be configured as inputs, e.g. by 
+ * BSP_GPIO_BOARD_PINS.
+ */
+
+#if BSP_CAPTURE == BSP_ENABLED
+
+/**
+ * @brief The DMA request used, TIM1_UP on DMA2 Stream5 Channel6.
+ */
+#define BSP_CAPTURE_DMA_REQ                 BSP_DMA_REQ_TIM1_UP
+
+/**
+ * @brief Supported capture modes.
+ */
+typedef enum
+{
+    BSP_CAPTURE_ONESHOT = 0,        ///<! Fill buffer 0 once
+    BSP_CAPTURE_STREAM,             ///<! Fill buffer 0 and 1 alternating
+    BSP_CAPTURE_TRIGGER             ///<! Buffer 0 circular with pre/post trigger
+
+} bspCaptureMode_t;
+
+/**
+ * @brief Called from the dma interrupt once a buffer is complete.
+ * 
+ * In streaming mode the other buffer is being filled meanwhile, so the data 
+ * has to be consumed before it is complete as well.
+ * 
+ * @param pBuf      The buffer.
+ * @param len       Its number of samples.
+ * @param pCtx      The context pointer passed to bspCaptureStart().
+ */
+typedef void (*bspCaptureCb_t)(uint16_t *pBuf, uint16_t len, void *pCtx);
+
+/**
+ * @brief Configuration of a capture.
+ */
+typedef struct
+{
+    bspGpioPin_t Port;              ///<! Any pin ID of the port to sample
+    bspCaptureMode_t Mode;          ///<! The capture mode
+    uint32_t RateHz;                ///<! Samples per second
+    uint16_t *pBuf[2];              ///<! pBuf[1] is used in stream mode
+    uint16_t Len;                   ///<! Samples per buffer
+    uint16_t Pre;                   ///<! Samples before the trigger
+    uint16_t Post;                  ///<! Samples after the trigger
+    bspCaptureCb_t Cb;              ///<! Optional, may be NULL
+    void *pCtx;                     ///<! Passed to Cb
+
+} bspCaptureCfg_t;
+
+/**
+ * @brief The samples around the trigger within the circular buffer.
+ */
+typedef struct
+{
+    const uint16_t *pBuf;           ///<! The circular buffer
+    uint16_t Len;                   ///<! Its size
+    uint16_t Start;                 ///<! Index of the first sample
+    uint16_t Cnt;                   ///<! Number of samples
+    uint16_t Pre;                   ///<! Number of samples before the trigger
+    uint16_t Lost;                  ///<! Pre trigger samples overwritten
+
+} bspCaptureWindow_t;
+
+/**
+ * @brief Used to get sample n of the given window.
+ */
+static inline uint16_t bspCaptureSample(const bspCaptureWindow_t *pWin, 
+    uint16_t n)
+{
+    return pWin->pBuf[(pWin->Start + n) % pWin->Len];
+}
+
+/**
+ * @brief Used to initialize the sampler, called by bspChipInit().
+ */
+void bspCaptureInit(void);
+
+/**
+ * @brief Used to start a capture.
+ * 
+ * The real rate is the timer clock divided by a integer, so it might differ
+ * slightly from the requested one. See bspCaptureGetRate().
+ * 
+ * ATTENTION: In trigger mode Len has to be even and Pre + Post must not 
+ * exceed Len / 2, as the end of the capture is detected in the half and 
+ * full transfer interrupts. In the worst case this leaves a single sample
+ * of slack, so samples taken during the latency of the stream interrupt 
+ * can overwrite the oldest pre trigger samples. Keep Pre + Post below 
+ * Len / 2 by the number of samples taken within the interrupt latency, see
+ * bspCaptureWindow_t::Lost.
+ *
+ * @param pCfg      The configuration, can be discarded afterwards but not 
+ *                  the buffers.
+ * 
+ * @return  BSP_OK on success.
+ *          BSP_EBUSY if a capture is still running.
+ *          BSP_EEINVAL in case of invalid arguments.
+ */
+bspStatus_t bspCaptureStart(const bspCaptureCfg_t *pCfg);
+
+/**
+ * @brief Used to stop the capture immediately.
+ */
+void bspCaptureStop(void);
+
+/**
+ * @brief Used to check if a capture is running.
+ */
+bool bspCaptureIsBusy(void);
+
+/**
+ * @brief Used to get the real rate of the current capture.
+ *
+ * @return  The rate in Hz.
+ */
+uint32_t bspCaptureGetRate(void);
+
+/**
+ * @brief Used to trigger a capture started in trigger mode. Can be called 
+ * from any interrupt, further calls are ignored.
+ */
+void bspCaptureTrigger(void);
+
+/**
+ * @brief Calls bspCaptureTrigger(), meant to be passed to bspExtiAttach() 
+ * to trigger on a edge of a pin.
+ */
+void bspCaptureExtiCb(void *pCtx);
+
+/**
+ * @brief Used to get the samples around the trigger.
+ * 
+ * Hence that less than Pre samples are returned if the trigger happened 
+ * before the buffer has been filled or if the oldest ones have been 
+ * overwritten before the capture could be stopped, see Lost.
+ *
+ * @param pWin      Where to store the window.
+ *
+ * @return  BSP_OK on success.
+ *          BSP_EBUSY if the capture has not completed yet.
+ */
+bspStatus_t bspCaptureGetWindow(bspCaptureWindow_t *pWin);
+
+/**
+ * @brief Used to print the given samples as hex to stdout, e.g. blocks 
+ * handed over by the callback in streaming mode. Do not call it from the
+ * callback itself.
+ *
+ * @param pBuf      The samples.
+ * @param len       The number of samples.
+ */
+void bspCaptureDump(const uint16_t *pBuf, uint16_t len);
+
+/**
+ * @brief Used to print the samples of the given window as hex to stdout.
+ *
+ * @param pWin      The window.
+ */
+void bspCaptureDumpWindow(const bspCaptureWindow_t *pWin);
+
+#endif /* BSP_CAPTURE == BSP_ENABLED */
+
+#endif /* BSP_NUCLEO_F446_CAPTURE_H_ */
@@ -0,0 +1,364 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+
+#ifndef BSP_NUCLEO_F446_CLOCK_H_
+#define BSP_NUCLEO_F446_CLOCK_H_
+
+#include "bsp/bsp.h"
+
+#include <stdint.h>
+
+/**
+ * System clock configuration.
+ *
+ * bspClockSolve() derives the PLL dividers, the flash wait states, the APB
+ * prescalers and the regulator settings for a given target SYSCLK from the 
+ * PLL input clock at compile time. The limits of the STM32F446 datasheet 
+ * (VDD 2.7V..3.6V) are checked by static asserts, so a profile which can not
+ * be met will not compile.
+ * 
+ * Three profiles are predefined and can be switched at runtime by 
+ * bspClockSetProfile(), BSP_CLOCK_PROFILE selects the one used at boot. A
+ * SYSCLK equal to the input clock is run straight from the HSE or HSI with
+ * the PLL turned off, which is what the low power profile does by default.
+ * 
+ * The PLL is fed by the HSE bypass input unless BSP_CLOCKSRC_HSI is enabled.
+ * If the HSE does not become ready within BSP_CLOCK_HSE_TIMEOUT_US the bsp 
+ * falls back to the HSI, all profiles are solved for both sources. 
+ */
+
+#ifndef BSP_HSE_HZ
+
+/**
+ * @brief The frequency of the HSE bypass input, 8MHz from the ST-Link MCO on
+ * the nucleo board.
+ */
+#define BSP_HSE_HZ                          8000000
+
+#endif
+
+/**
+ * @brief The frequency of the internal RC oscillator.
+ */
+#define BSP_HSI_HZ                          16000000
+
+#ifndef BSP_CLOCK_HSE_TIMEOUT_US
+
+/**
+ * @brief Maximum time to wait for the HSE at boot in us.
+ */
+#define BSP_CLOCK_HSE_TIMEOUT_US            10000
+
+#endif
+
+#ifndef BSP_CLOCK_PERFORMANCE_HZ
+
+/**
+ * @brief SYSCLK of the performance profile, needs over-drive above 168MHz.
+ */
+#define BSP_CLOCK_PERFORMANCE_HZ            180000000
+
+#endif
+
+#ifndef BSP_CLOCK_BALANCED_HZ
+
+/**
+ * @brief SYSCLK of the balanced profile.
+ */
+#define BSP_CLOCK_BALANCED_HZ               100000000
+
+#endif
+
+#ifndef BSP_CLOCK_LOWPOWER_HZ
+
+/**
+ * @brief SYSCLK of the low power profile, 0 to run straight from the HSE or
+ * HSI with the PLL turned off.
+ */
+#define BSP_CLOCK_LOWPOWER_HZ               0
+
+#endif
+
+#ifndef BSP_CLOCK_PROFILE
+
+/**
+ * @brief The profile used at boot.
+ */
+#define BSP_CLOCK_PROFILE                   BSP_CLOCK_BALANCED
+
+#endif
+
+/**
+ * @brief Limits of the STM32F446.
+ */
+#define BSP_CLOCK_SYSCLK_MAX                180000000
+#define BSP_CLOCK_SYSCLK_MAX_NOOD           168000000
+#define BSP_CLOCK_APB1_MAX                  45000000
+#define BSP_CLOCK_APB2_MAX                  90000000
+#define BSP_CLOCK_VCOIN_MIN                 1000000
+#define BSP_CLOCK_VCOIN_MAX                 2000000
+#define BSP_CLOCK_VCO_MIN                   100000000
+#define BSP_CLOCK_VCO_MAX                   432000000
+#define BSP_CLOCK_USB_MAX                   48000000
+#define BSP_CLOCK_HZ_PER_WS                 30000000
+
+/**
+ * @brief The predefined clock profiles.
+ */
+typedef enum
+{
+    BSP_CLOCK_PERFORMANCE = 0,      ///<! BSP_CLOCK_PERFORMANCE_HZ
+    BSP_CLOCK_BALANCED,             ///<! BSP_CLOCK_BALANCED_HZ
+    BSP_CLOCK_LOWPOWER,             ///<! BSP_CLOCK_LOWPOWER_HZ
+    BSP_CLOCK_CNT
+
+} bspClockProfile_t;
+
+/**
+ * @brief The PLL input clock sources.
+ */
+typedef enum
+{
+    BSP_CLOCK_SRC_HSE = 0,          ///<! External clock, BSP_HSE_HZ
+    BSP_CLOCK_SRC_HSI,              ///<! Internal RC oscillator, BSP_HSI_HZ
+    BSP_CLOCK_SRC_CNT
+
+} bspClockSrc_t;
+
+/**
+ * @brief A complete clock configuration as computed by bspClockSolve().
+ */
+typedef struct
+{
+    bspClockSrc_t Src;              ///<! PLL input clock source
+    uint32_t InHz;                  ///<! PLL input clock in Hz
+    uint32_t SysClk;                ///<! Resulting SYSCLK and HCLK in Hz
+    bool Pll;                       ///<! False if SYSCLK is the input clock
+    uint32_t M;                     ///<! PLLM, 2..63
+    uint32_t N;                     ///<! PLLN, 50..432
+    uint32_t P;                     ///<! PLLP, 2, 4, 6 or 8
+    uint32_t Q;                     ///<! PLLQ, 2..15
+    uint32_t Latency;               ///<! Flash wait states
+    uint32_t Apb1Div;               ///<! APB1 prescaler, 1..16
+    uint32_t Apb2Div;               ///<! APB2 prescaler, 1..16
+    uint32_t Vos;                   ///<! Regulator voltage scale, 1..3
+    bool OverDrive;                 ///<! True if over-drive is needed
+    bool Valid;                     ///<! False if there is no solution
+
+} bspClockCfg_t;
+
+/**
+ * @brief Used to get the smallest APB prescaler which keeps the bus clock
+ * below the given limit.
+ */
+static constexpr uint32_t bspClockApbDiv(uint32_t hclk, uint32_t max)
+{
+    uint32_t div = 1;
+
+    while (div < 16 && hclk / div > max)
+        div *= 2;
+
+    return div;
+}
+
+/**
+ * @brief Used to compute a clock configuration at compile time.
+ * 
+ * If sysClk equals the input clock the PLL is not used. Otherwise the 
+ * first M which results in a VCO input of 1..2MHz wins, hence the 
+ * highest possible comparison frequency for the lowest jitter. PLLQ is 
+ * chosen to stay at or below 48MHz, an exact 48MHz for USB is generally not 
+ * reachable together with the SYSCLK target.
+ * 
+ * @param inHz      The PLL input clock in Hz.
+ * @param sysClk    The desired SYSCLK in Hz, has to be met exactly.
+ * @param src       The source of the PLL input clock.
+ * 
+ * @return  The configuration, Valid is false if there is no solution.
+ */
+static constexpr bspClockCfg_t bspClockSolve(uint32_t inHz, uint32_t sysClk,
+    bspClockSrc_t src = BSP_CLOCK_SRC_HSE)
+{
+    bspClockCfg_t cfg = 
+        {src, inHz, sysClk, true, 0, 0, 0, 0, 0, 0, 0, 0, false, false};
+
+    if (sysClk == 0 || sysClk > BSP_CLOCK_SYSCLK_MAX)
+        return cfg;
+
+    if (sysClk == inHz)
+    {
+        cfg.Pll = false;
+        cfg.Valid = true;
+    }
+
+    for (uint32_t m = 2; m <= 63 && !cfg.Valid; m++)
+    {
+        uint32_t vcoIn = inHz / m;
+
+        if (inHz % m != 0 || 
+            vcoIn < BSP_CLOCK_VCOIN_MIN || vcoIn > BSP_CLOCK_VCOIN_MAX)
+            continue;
+
+        for (uint32_t p = 2; p <= 8 && !cfg.Valid; p += 2)
+        {
+            uint64_t vco = (uint64_t) sysClk * p;
+
+            if (vco < BSP_CLOCK_VCO_MIN || vco > BSP_CLOCK_VCO_MAX || 
+                vco % vcoIn != 0)
+                continue;
+
+            uint32_t n = vco / vcoIn;
+
+            if (n < 50 || n > 432)
+                continue;
+
+            cfg.M = m;
+            cfg.N = n;
+            cfg.P = p;
+            cfg.Q = (vco + BSP_CLOCK_USB_MAX - 1) / BSP_CLOCK_USB_MAX;
+            cfg.Valid = true;
+        }
+    }
+
+    if (!cfg.Valid)
+        return cfg;
+
+    if (cfg.Pll && cfg.Q < 2)
+        cfg.Q = 2;
+
+    cfg.Valid = !cfg.Pll || cfg.Q <= 15;
+    cfg.Latency = (sysClk - 1) / BSP_CLOCK_HZ_PER_WS;
+    cfg.Apb1Div = bspClockApbDiv(sysClk, BSP_CLOCK_APB1_MAX);
+    cfg.Apb2Div = bspClockApbDiv(sysClk, BSP_CLOCK_APB2_MAX);
+    cfg.OverDrive = sysClk > BSP_CLOCK_SYSCLK_MAX_NOOD;
+    cfg.Vos = sysClk > 144000000 ? 1 : sysClk > 120000000 ? 2 : 3;
+
+    return cfg;
+}
+
+/**
+ * @brief Used to check all limits of a configuration at compile time, e.g.
+ * BSP_CLOCK_CHECK(bspClockSolve(BSP_HSE_HZ, 150000000)).
+ */
+#define BSP_CLOCK_CHECK(_cfg)                                               \
+                                                                            \
+    static_assert((_cfg).Valid,                                             \
+        "No PLL configuration for this SYSCLK and input clock");            \
+    static_assert(!(_cfg).Pll ? (_cfg).InHz == (_cfg).SysClk :              \
+        (_cfg).InHz / (_cfg).M * (_cfg).N / (_cfg).P == (_cfg).SysClk,      \
+        "PLL does not meet the SYSCLK");                                    \
+    static_assert(!(_cfg).Pll ||                                            \
+        ((_cfg).InHz / (_cfg).M * (_cfg).N <= BSP_CLOCK_VCO_MAX &&          \
+         (_cfg).InHz / (_cfg).M * (_cfg).N >= BSP_CLOCK_VCO_MIN),           \
+        "VCO out of range");                                                \
+    static_assert((_cfg).SysClk <= BSP_CLOCK_SYSCLK_MAX,                    \
+        "SYSCLK too high");                                                 \
+    static_assert((_cfg).SysClk <= BSP_CLOCK_SYSCLK_MAX_NOOD ||             \
+        (_cfg).OverDrive, "SYSCLK needs over-drive");                       \
+    static_assert((_cfg).SysClk / (_cfg).Apb1Div <= BSP_CLOCK_APB1_MAX,     \
+        "APB1 too fast");                                                   \
+    static_assert((_cfg).SysClk / (_cfg).Apb2Div <= BSP_CLOCK_APB2_MAX,     \
+        "APB2 too fast");                                                   \
+    static_assert((_cfg).Latency <= 15 &&                                   \
+        (_cfg).SysClk <= ((_cfg).Latency + 1) * BSP_CLOCK_HZ_PER_WS,        \
+        "Not enough flash wait states")
+
+/**
+ * @brief Used to start the PLL input clock at boot, called by bspChipInit().
+ * 
+ * Waits at most BSP_CLOCK_HSE_TIMEOUT_US for the HSE and selects the HSI if
+ * it fails or if BSP_CLOCKSRC_HSI is enabled. Hence that the timeout is 
+ * measured with the cycle counter, so the core has to run from the HSI.
+ * 
+ * @return  The selected source.
+ */
+bspClockSrc_t bspClockStart(void);
+
+/**
+ * @brief Used to get the PLL input clock source selected by bspClockStart().
+ * 
+ * @return  The source.
+ */
+bspClockSrc_t bspClockGetSource(void);
+
+/**
+ * @brief Used to get the configuration of the given profile for the current
+ * clock source.
+ *
+ * @param profile   The profile.
+ * 
+ * @return  The configuration, NULL if the profile is invalid.
+ */
+const bspClockCfg_t *bspClockGetCfg(bspClockProfile_t profile);
+
+/**
+ * @brief Used to apply a clock configuration.
+ * 
+ * Switches to the HSI while the PLL, the regulator and the flash are 
+ * reconfigured, the PLL stays off if the configuration does not need it. 
+ * Updates SystemCoreClock, the sys tick reload value and the
+ * baud rate of the tty. Pending tty output is sent before.
+ * 
+ * ATTENTION: Timers which have been set up for a rate before, e.g. the 
+ * profiler, waveform engine and port sampler, continue to run with the old 
+ * settings at a different rate. Stop them before and start them again 
+ * afterwards. The sys tick is stretched for the duration of the switch.
+ * 
+ * Hence that this must not be called from an interrupt.
+ *
+ * @param pCfg      The configuration, see bspClockSolve().
+ * 
+ * @return  BSP_EEINVAL if the configuration is not valid, BSP_ERR if its 
+ *          source is not running, BSP_OK otherwise.
+ */
+bspStatus_t bspClockApply(const bspClockCfg_t *pCfg);
+
+/**
+ * @brief Used to switch to one of the predefined profiles.
+ * 
+ * See bspClockApply().
+ *
+ * @param profile   The profile to use.
+ * 
+ * @return  BSP_EEINVAL if the profile is invalid, BSP_OK otherwise.
+ */
+bspStatus_t bspClockSetProfile(bspClockProfile_t profile);
+
+/**
+ * @brief Used to get the current profile.
+ * 
+ * @return  The profile, BSP_CLOCK_CNT if a custom configuration has been 
+ *          applied by bspClockApply().
+ */
+bspClockProfile_t bspClockGetProfile(void);
+
+/**
+ * @brief Used to get the cycle counter value at the moment the core has been
+ * switched to the target clock by the last bspClockApply(), e.g. to tell 
+ * the cycles taken at the HSI from the ones taken at the target clock.
+ * 
+ * @return  The cycle counter value.
+ */
+uint32_t bspClockGetSwitchCycle(void);
+
+#endif /* BSP_NUCLEO_F446_CLOCK_H_ */
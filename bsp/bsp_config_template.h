@@ -34,15 +34,49 @@
 #define BSP_DISABLED                      0
 
 /**
- * Enable to use the internal oscilator.
+ * Enable to use the internal oscilator as PLL input.
  * 
- * Attetion:  If enable the system clock will be set to 64MHz
- *              
- *            If disabled or undefined the system clock we be generated from
- *            HSE bypass and will be set to 72Mhz. It is assumed that a 8MHz
- *            is provided to the external clock input.
+ * If disabled the PLL is fed by the HSE bypass input, it is assumed that 
+ * BSP_HSE_HZ (8MHz by default) is provided to the external clock input. If
+ * it does not become ready within BSP_CLOCK_HSE_TIMEOUT_US the bsp falls 
+ * back to the internal oscilator and reports that on the tty.
  */
 #define BSP_CLOCKSRC_HSI                  BSP_DISABLED
+#define BSP_CLOCK_HSE_TIMEOUT_US          10000
+
+/**
+ * The clock profile used at boot, see bsp_clock.h. BSP_CLOCK_PERFORMANCE 
+ * runs at 180MHz with over-drive, BSP_CLOCK_BALANCED at 100MHz and 
+ * BSP_CLOCK_LOWPOWER straight from the HSE (8MHz) or HSI (16MHz) with the 
+ * PLL turned off. The frequencies can be changed by defining 
+ * BSP_CLOCK_<PROFILE>_HZ here.
+ */
+#define BSP_CLOCK_PROFILE                 BSP_CLOCK_BALANCED
+
+/**
+ * If enabled bspChipInit() only brings up the clocks, the pins and the tty. 
+ * All other modules are initialized by bspChipInitDeferred() which has to 
+ * be called by the application. See bspGetInitTime().
+ */
+#define BSP_FAST_BOOT                     BSP_DISABLED
+
+/**
+ * If enabled the flash ART accelerator (instruction and data cache) and the
+ * prefetch buffer are enabled by bspChipInit().
+ */
+#define BSP_FLASH_ART                     BSP_ENABLED
+
+/**
+ * If enabled the sys tick, the tty and the EXTI15_10 interrupt handlers are
+ * placed in SRAM to run without flash wait states, see BSP_RAMFUNC in bsp.h.
+ */
+#define BSP_ISR_RAM                       BSP_DISABLED
+
+/**
+ * If enabled the vector table is copied to SRAM by bspChipInit(), handlers
+ * can then be installed at runtime by bspSetVector().
+ */
+#define BSP_VECT_RAM                      BSP_DISABLED
 
 /**
  * If enabled the bsp implements the sys tick interrupt and runs a tick counter.
@@ -93,6 +127,16 @@
  *             the BSP uses internally like the serial port etc.
  */
 
+/**
+ * Board specific pins which shall be initialized by bspGpioInit() together
+ * with the pins used by the bsp, as comma separated bspGpioCfg_t entries. 
+ * See bsp_gpio.h, e.g.:
+ * 
+ * #define BSP_GPIO_BOARD_PINS                                              \
+ *    { BSP_GPIO_B0, LL_GPIO_MODE_OUTPUT, LL_GPIO_SPEED_FREQ_LOW,          \
+ *      LL_GPIO_OUTPUT_PUSHPULL, LL_GPIO_PULL_NO, LL_GPIO_AF_0, 1 },
+ */
+
 /**
  * Debug pins for use with a logic analyzer.
  */
@@ -101,14 +145,126 @@
 #define BSP_GPIO_C2                       BSP_DEBUGPIN_2
 #define BSP_GPIO_C3                       BSP_DEBUGPIN_3
 
+/**
+ * If enabled the debug pins are initialized as outputs and driven by the
+ * trace macros of bsp_trace.h, by default on every bsp isr entry and exit.
+ */
+#define BSP_TRACE                         BSP_DISABLED
+
+/**
+ * If enabled the bsp implements a statistical pc sampling profiler, see
+ * bsp_prof.h and tools/bsp_prof.py.
+ */
+#define BSP_PROF                          BSP_DISABLED
+
+/**
+ * Defines how samples are stored, either BSP_PROF_MODE_HASH to count samples
+ * per pc or BSP_PROF_MODE_RING to stream raw pc/lr samples.
+ */
+#define BSP_PROF_MODE                     BSP_PROF_MODE_HASH
+
+/**
+ * If enabled the profiler samples in the TIM7 interrupt at BSP_PROF_RATE_HZ,
+ * if disabled in the sys tick interrupt at 1kHz.
+ */
+#define BSP_PROF_TIMER                    BSP_DISABLED
+#define BSP_PROF_RATE_HZ                  10000
+
+/**
+ * If enabled EXTI lines can be attached in capture mode, which records the
+ * cycle counter and the pin level of each edge. See bsp_exti.h.
+ */
+#define BSP_EXTI_CAPTURE                  BSP_DISABLED
+
+/**
+ * If enabled inputs can be debounced by sampling them in the sys tick 
+ * interrupt, which emits press, release, long press and repeat events. If
+ * BSP_DEBOUNCE_BUTTON is enabled as well the user button is debounced 
+ * instead of using the EXTI interrupt. See bsp_debounce.h.
+ */
+#define BSP_DEBOUNCE                      BSP_DISABLED
+#define BSP_DEBOUNCE_BUTTON               BSP_ENABLED
+
+/**
+ * If enabled interrupts can defer work to bspRunPending() by a lock free 
+ * queue. If BSP_WORK_PENDSV is enabled as well the work is run by the 
+ * PendSV exception at the lowest priority, otherwise bspRunPending() has to
+ * be called by the main loop. See bsp_work.h.
+ */
+#define BSP_WORK                          BSP_DISABLED
+#define BSP_WORK_PENDSV                   BSP_DISABLED
+
+/**
+ * If enabled the bsp implements a event driven run to completion scheduler
+ * with preemptive priority levels on a single stack. See bsp_sched.h.
+ */
+#define BSP_SCHED                         BSP_DISABLED
+
+/**
+ * If enabled the tty and the delay block on FreeRTOS objects when called 
+ * from a task and the sys tick is forwarded to the FreeRTOS port. Needs 
+ * FreeRTOSConfig.h to match the bsp, see bsp_rtos.h.
+ */
+#define BSP_RTOS                          BSP_DISABLED
+
+/**
+ * If enabled the bsp implements a DMA waveform engine which streams 
+ * precomputed BSRR words to a gpio port, paced by TIM8. See bsp_wave.h.
+ */
+#define BSP_WAVE                          BSP_DISABLED
+
+/**
+ * If enabled the bsp implements a DMA gpio port sampler paced by TIM1, with
+ * one shot, streaming and pre/post trigger modes. See bsp_capture.h.
+ */
+#define BSP_CAPTURE                       BSP_DISABLED
+
+/**
+ * If enabled the bsp implements a frequency and duty cycle meter on 
+ * BSP_GPIO_ICAP (PA0) using TIM5 input capture and DMA. See bsp_icap.h.
+ */
+#define BSP_ICAP                          BSP_DISABLED
+
+/**
+ * If enabled memory can be copied and filled asynchronously by a DMA2 
+ * stream, see bspDmaMemcpyAsync() in bsp_dma.h.
+ */
+#define BSP_DMA_M2M                       BSP_DISABLED
+
+/**
+ * DMA requests used by the application as comma separated bspDmaReq_t 
+ * entries. They are checked at compile time against each other and against
+ * the requests of the enabled bsp modules for streams used twice. See 
+ * bsp_dma.h, e.g.:
+ * 
+ * #define BSP_DMA_USER_REQS                                                \
+ *    BSP_DMA_REQ_SPI1_TX, BSP_DMA_REQ_SPI1_RX,
+ */
+
 /**
  * Interrupt priority configuration.
  *
- * See bsp.h for min max vaules and how they should be interpreted.
+ * See bsp.h for min max vaules and how they should be interpreted. All 
+ * interrupts of the bsp use BSP_IRQPRIO_CRITICAL or a lower priority, so 
+ * application interrupts above it are never delayed by the bsp. Hence that
+ * the profiler can not sample interrupts above its own priority. The plan
+ * is checked at compile time in bsp.cpp.
+ */
+#define BSP_IRQPRIO_SYSTICK               BSP_IRQPRIO_CRITICAL
+#define BSP_IRQPRIO_EXTI                  (BSP_IRQPRIO_CRITICAL + 1)
+#define BSP_IRQPRIO_TTY                   (BSP_IRQPRIO_CRITICAL + 2)
+#define BSP_IRQPRIO_PROF                  BSP_IRQPRIO_CRITICAL
+#define BSP_IRQPRIO_WAVE                  (BSP_IRQPRIO_CRITICAL + 1)
+#define BSP_IRQPRIO_CAPTURE               (BSP_IRQPRIO_CRITICAL + 1)
+#define BSP_IRQPRIO_ICAP                  (BSP_IRQPRIO_CRITICAL + 2)
+#define BSP_IRQPRIO_DMA_M2M               (BSP_IRQPRIO_CRITICAL + 2)
+#define BSP_IRQPRIO_SCHED                 (BSP_IRQPRIO_CRITICAL + 3)
+
+/**
+ * If enabled all interrupt service routines of the bsp record their execution
+ * time (and where measurable their entry latency) in cycles. See bsp_isr.h.
  */
-#define BSP_IRQPRIO_SYSTICK               BSP_IRQPRIO_MAX
-#define BSP_IRQPRIO_EXTI                  (BSP_IRQPRIO_MAX + 1)
-#define BSP_IRQPRIO_TTY                   (BSP_IRQPRIO_MAX + 2)
+#define BSP_ISR_STATS                     BSP_DISABLED
 
 /**
  * If enabled bsp_assert.h will implement assertions.
@@ -125,6 +281,50 @@
  */
 #define BSP_ASSERT_MESSAGE                BSP_ENABLED
 
+/**
+ * If enabled the fault handlers and failed assertions write a crash record 
+ * to the backup SRAM and reset the cpu, the record is reported at the next
+ * boot. The fault handlers in stm32f4xx_it.c have to be removed. See 
+ * bsp_crash.h.
+ */
+#define BSP_CRASH                         BSP_DISABLED
+
+/**
+ * If enabled events can be appended to a log in the backup SRAM which
+ * survives resets, see bsp_evlog.h.
+ */
+#define BSP_EVLOG                         BSP_DISABLED
+
+/**
+ * If enabled the event log of the previous run is printed at boot.
+ */
+#define BSP_EVLOG_BOOT_DUMP               BSP_ENABLED
+
+/**
+ * If enabled the event log uses the cycle counter as time stamp instead of
+ * the sys tick.
+ */
+#define BSP_EVLOG_CYCLES                  BSP_DISABLED
+
+/**
+ * If enabled the backup regulator is turned on, so the backup SRAM keeps
+ * its content on VBAT. Needs a battery at the VBAT pin.
+ */
+#define BSP_BKPSRAM_VBAT                  BSP_DISABLED
+
+/**
+ * If enabled the independent watchdog is started at boot and fed as long as
+ * all clients check in within their deadlines, see bsp_wdg.h.
+ */
+#define BSP_WDG                           BSP_DISABLED
+
+/**
+ * If enabled bspAbort() resets the cpu by the watchdog right after the 
+ * message, otherwise the watchdog resets it after BSP_WDG_TIMEOUT_MS as the
+ * sys tick interrupt is blocked. Has no effect if BSP_CRASH is enabled.
+ */
+#define BSP_WDG_ABORT_RESET               BSP_ENABLED
+
 /**
  * Defines the intervall between asseet messages in ms
  */
@@ -0,0 +1,140 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+
+#ifndef BSP_NUCLEO_F446_CRASH_H_
+#define BSP_NUCLEO_F446_CRASH_H_
+
+#include "bsp/bsp.h"
+
+#include <stdint.h>
+
+/**
+ * Crash capture.
+ * 
+ * The HardFault, MemManage, BusFault and UsageFault handlers and bspAbort() 
+ * write a crash record to the backup SRAM and reset the cpu right away. The
+ * record holds the stacked registers, the fault status registers, a stack 
+ * snapshot and, for assertions, the function and line. It is protected by a
+ * CRC and reported together with the reset cause on the tty at the next 
+ * boot. A watchdog client which missed its deadline is recorded as well,
+ * see bsp_wdg.h.
+ * 
+ * Hence that the fault handlers are implemented by the bsp, the ones 
+ * generated by STM32CubeMX in stm32f4xx_it.c have to be removed.
+ */
+
+#if BSP_CRASH == BSP_ENABLED
+
+#ifndef BSP_CRASH_STACK_WORDS
+
+/**
+ * @brief Number of stack words above the exception frame to record.
+ */
+#define BSP_CRASH_STACK_WORDS               16
+
+#endif
+
+/**
+ * @brief The causes of a crash record.
+ */
+typedef enum
+{
+    BSP_CRASH_NONE = 0,             ///<! No record
+    BSP_CRASH_HARDFAULT,            ///<! HardFault_Handler
+    BSP_CRASH_MEMMANAGE,            ///<! MemManage_Handler
+    BSP_CRASH_BUSFAULT,             ///<! BusFault_Handler
+    BSP_CRASH_USAGEFAULT,           ///<! UsageFault_Handler
+    BSP_CRASH_ASSERT,               ///<! bspAbort()
+    BSP_CRASH_WATCHDOG,             ///<! A watchdog client missed its deadline
+    BSP_CRASH_CNT
+
+} bspCrashType_t;
+
+/**
+ * @brief A crash record.
+ */
+typedef struct
+{
+    uint32_t Magic;
+    uint32_t Type;                  ///<! See bspCrashType_t
+    uint32_t Tick;                  ///<! Sys tick at the time of the crash
+    bspExcFrame_t Frame;            ///<! The stacked registers
+    uint32_t ExcReturn;             ///<! lr on exception entry
+    uint32_t Sp;                    ///<! Address of the frame
+    uint32_t Cfsr;
+    uint32_t Hfsr;
+    uint32_t Mmfar;
+    uint32_t Bfar;
+    uint32_t Line;                  ///<! Assertions, the watchdog client ID
+    char Func[32];                  ///<! Assertions, the watchdog client name
+    uint32_t Stack[BSP_CRASH_STACK_WORDS];
+    uint32_t Crc;
+
+} bspCrashRecord_t;
+
+/**
+ * @brief Used to enable the fault handlers and to fetch the record of the 
+ * previous run, called by bspChipInit().
+ */
+void bspCrashInit(void);
+
+/**
+ * @brief Used to print the reset cause and the record of the previous run,
+ * called by bspChipInit() once the tty is up.
+ */
+void bspCrashReport(void);
+
+/**
+ * @brief Used to get the record of the previous run.
+ *
+ * @param pRec      Where to store the record.
+ *
+ * @return  BSP_OK on success.
+ *          BSP_EEMPTY if the previous run did not crash.
+ */
+bspStatus_t bspCrashGetLast(bspCrashRecord_t *pRec);
+
+/**
+ * @brief Used to record a failed assertion and to reset, called by 
+ * bspAbort().
+ *
+ * @param pFunc     The function of the assertion.
+ * @param line      The line of the assertion.
+ * @param pc        The address the assertion has been called from.
+ */
+void bspCrashAbort(const char *pFunc, int line, uint32_t pc) 
+    __attribute__((noreturn));
+
+/**
+ * @brief Used to record a watchdog client which missed its deadline, called
+ * by bspWdgTick(). Hence that the cpu is not reset, this is left to the 
+ * watchdog.
+ *
+ * @param client    The ID of the client.
+ * @param pName     The name of the client.
+ */
+void bspCrashWatchdog(uint32_t client, const char *pName);
+
+#endif /* BSP_CRASH == BSP_ENABLED */
+
+#endif /* BSP_NUCLEO_F446_CRASH_H_ */
@@ -0,0 +1,194 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+#ifndef BSP_NUCLEO_F446_DEBOUNCE_H_
+#define BSP_NUCLEO_F446_DEBOUNCE_H_
+
+#include "bsp/bsp.h"
+#include "bsp/bsp_gpio.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Debouncing of buttons and other slow digital inputs.
+ * 
+ * All inputs are sampled in the sys tick interrupt every 
+ * BSP_DEBOUNCE_TICK_MS. Each sample is shifted into a per input history, 
+ * the debounced state changes once the last BSP_DEBOUNCE_SAMPLES samples 
+ * agree. State changes, long presses and repeats are written to a event 
+ * queue which is drained by the application using bspDebounceGetEvent(). 
+ * So the cost is fixed and does not depend on bouncing contacts.
+ * 
+ * If BSP_DEBOUNCE_BUTTON is enabled the user button is handled as input 
+ * BSP_DEBOUNCE_BUTTON_ID instead of the EXTI interrupt and bspButtonIrqCb().
+ */
+
+#if BSP_DEBOUNCE == BSP_ENABLED
+
+#if BSP_SYSTICK != BSP_ENABLED
+#error Debouncing needs BSP_SYSTICK
+#endif
+
+#ifndef BSP_DEBOUNCE_NUM
+
+/**
+ * @brief Number of inputs.
+ */
+#define BSP_DEBOUNCE_NUM                    4
+
+#endif
+
+#ifndef BSP_DEBOUNCE_TICK_MS
+
+/**
+ * @brief Sample period in ms.
+ */
+#define BSP_DEBOUNCE_TICK_MS                5
+
+#endif
+
+#ifndef BSP_DEBOUNCE_SAMPLES
+
+/**
+ * @brief Number of equal samples needed to change the state, 1 to 8.
+ */
+#define BSP_DEBOUNCE_SAMPLES                4
+
+#endif
+
+#ifndef BSP_DEBOUNCE_LONG_MS
+
+/**
+ * @brief Time in ms after which a pressed input causes a long press event.
+ */
+#define BSP_DEBOUNCE_LONG_MS                1000
+
+#endif
+
+#ifndef BSP_DEBOUNCE_REPEAT_MS
+
+/**
+ * @brief Period in ms of the repeat events after a long press, 0 to disable 
+ * repeat events.
+ */
+#define BSP_DEBOUNCE_REPEAT_MS              200
+
+#endif
+
+#ifndef BSP_DEBOUNCE_QUEUE
+
+/**
+ * @brief Size of the event queue, has to be a power of two.
+ */
+#define BSP_DEBOUNCE_QUEUE                  16
+
+#endif
+
+/**
+ * @brief The input used for the user button.
+ */
+#define BSP_DEBOUNCE_BUTTON_ID              0
+
+/**
+ * @brief Types of events.
+ */
+typedef enum
+{
+    BSP_DEBOUNCE_PRESS = 0,         ///<! The input became active
+    BSP_DEBOUNCE_RELEASE,           ///<! The input became inactive
+    BSP_DEBOUNCE_LONG,              ///<! Active for BSP_DEBOUNCE_LONG_MS
+    BSP_DEBOUNCE_REPEAT             ///<! Periodically after a long press
+
+} bspDebounceEvType_t;
+
+/**
+ * @brief A debounce event.
+ */
+typedef struct
+{
+    uint32_t Time;                  ///<! Sys tick at the time of the event
+    uint8_t Input;                  ///<! The input ID
+    uint8_t Type;                   ///<! See bspDebounceEvType_t
+
+} bspDebounceEvent_t;
+
+/**
+ * @brief Used to initialize the debouncing, called by bspChipInit().
+ */
+void bspDebounceInit(void);
+
+/**
+ * @brief Used to add a input. 
+ * 
+ * Hence that the pin has to be configured as input, e.g. by 
+ * BSP_GPIO_BOARD_PINS.
+ *
+ * @param input     The ID of the input, 0 to BSP_DEBOUNCE_NUM - 1.
+ * @param pin       The bsp gpio pin ID, has to refer to a single pin.
+ * @param activeLow True if the input is active (pressed) at low level.
+ *
+ * @return  BSP_OK on success.
+ *          BSP_EBUSY if the input ID is already used.
+ *          BSP_EEINVAL in case of invalid arguments.
+ */
+bspStatus_t bspDebounceAdd(uint32_t input, bspGpioPin_t pin, bool activeLow);
+
+/**
+ * @brief Used to remove a input.
+ *
+ * @param input     The ID of the input.
+ */
+void bspDebounceRemove(uint32_t input);
+
+/**
+ * @brief Used to get the debounced state of a input.
+ *
+ * @param input     The ID of the input.
+ * 
+ * @return  true if the input is active.
+ */
+bool bspDebounceIsActive(uint32_t input);
+
+/**
+ * @brief Used to get the oldest event from the queue.
+ *
+ * @param pEv       Where to store the event.
+ *
+ * @return  BSP_OK on success.
+ *          BSP_EEMPTY if there is no event.
+ */
+bspStatus_t bspDebounceGetEvent(bspDebounceEvent_t *pEv);
+
+/**
+ * @brief Used to get the number of events lost due to a full queue.
+ */
+uint32_t bspDebounceGetLost(void);
+
+/**
+ * @brief Used to sample all inputs, called by the sys tick interrupt.
+ */
+void bspDebounceTick(void);
+
+#endif /* BSP_DEBOUNCE == BSP_ENABLED */
+
+#endif /* BSP_NUCLEO_F446_DEBOUNCE_H_ */
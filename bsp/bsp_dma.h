@@ -0,0 +1,603 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+
+#ifndef BSP_NUCLEO_F446_DMA_H_
+#define BSP_NUCLEO_F446_DMA_H_
+
+#include <stm32f4xx_ll_dma.h>
+
+#include "bsp/bsp.h"
+
+#include <stdint.h>
+
+/**
+ * DMA request mapping and stream allocator.
+ *
+ * Each peripheral request of the STM32F446 is hard wired to one or two 
+ * streams of DMA1 or DMA2 and selected by the channel of the stream, see 
+ * RM0390 table 28 and 29. bspDmaMap holds that mapping, requests with a 
+ * second possible stream have a _ALT entry. Requests which share a line 
+ * (e.g. TIM2_UP and TIM2_CH3) have separate entries on the same stream.
+ * Memory to memory transfers are only supported by DMA2 and can use any of 
+ * its streams, the BSP_DMA_REQ_M2M_Sx entries.
+ * 
+ * Drivers claim the stream of their request by bspDmaClaim() which fails if
+ * the stream is already in use. The requests of all enabled bsp modules and
+ * those listed in BSP_DMA_USER_REQS are checked for conflicts at compile 
+ * time. The stream interrupts are implemented by the bsp and routed to the 
+ * handler passed to bspDmaClaim().
+ */
+
+/**
+ * @brief The DMA requests of the STM32F446, see RM0390 tables 28 and 29. 
+ * 
+ * Hence that the FMPI2C1 requests are not covered. Timer requests which
+ * share a stream and channel are listed once per request, except for the
+ * combined CH1, CH2 and CH3 requests of TIM1 and TIM8 on channel 0.
+ */
+typedef enum
+{
+    BSP_DMA_REQ_SPI3_RX = 0,    ///<! DMA1 Stream0 Channel0
+    BSP_DMA_REQ_SPI3_RX_ALT,    ///<! DMA1 Stream2 Channel0
+    BSP_DMA_REQ_SPI2_RX,        ///<! DMA1 Stream3 Channel0
+    BSP_DMA_REQ_SPI2_TX,        ///<! DMA1 Stream4 Channel0
+    BSP_DMA_REQ_SPI3_TX,        ///<! DMA1 Stream5 Channel0
+    BSP_DMA_REQ_SPI3_TX_ALT,    ///<! DMA1 Stream7 Channel0
+    BSP_DMA_REQ_SPDIFRX_DT,     ///<! DMA1 Stream1 Channel0
+    BSP_DMA_REQ_SPDIFRX_CS,     ///<! DMA1 Stream6 Channel0
+    BSP_DMA_REQ_I2C1_RX,        ///<! DMA1 Stream0 Channel1
+    BSP_DMA_REQ_I2C1_RX_ALT,    ///<! DMA1 Stream5 Channel1
+    BSP_DMA_REQ_I2C1_TX,        ///<! DMA1 Stream6 Channel1
+    BSP_DMA_REQ_I2C1_TX_ALT,    ///<! DMA1 Stream7 Channel1
+    BSP_DMA_REQ_TIM7_UP,        ///<! DMA1 Stream2 Channel1
+    BSP_DMA_REQ_TIM7_UP_ALT,    ///<! DMA1 Stream4 Channel1
+    BSP_DMA_REQ_TIM4_CH1,       ///<! DMA1 Stream0 Channel2
+    BSP_DMA_REQ_TIM4_CH2,       ///<! DMA1 Stream3 Channel2
+    BSP_DMA_REQ_TIM4_UP,        ///<! DMA1 Stream6 Channel2
+    BSP_DMA_REQ_TIM4_CH3,       ///<! DMA1 Stream7 Channel2
+    BSP_DMA_REQ_I2C3_RX,        ///<! DMA1 Stream2 Channel3
+    BSP_DMA_REQ_I2C3_TX,        ///<! DMA1 Stream4 Channel3
+    BSP_DMA_REQ_TIM2_UP,        ///<! DMA1 Stream1 Channel3
+    BSP_DMA_REQ_TIM2_CH3,       ///<! DMA1 Stream1 Channel3
+    BSP_DMA_REQ_TIM2_CH1,       ///<! DMA1 Stream5 Channel3
+    BSP_DMA_REQ_TIM2_CH2,       ///<! DMA1 Stream6 Channel3
+    BSP_DMA_REQ_TIM2_CH4,       ///<! DMA1 Stream6 Channel3
+    BSP_DMA_REQ_TIM2_UP_ALT,    ///<! DMA1 Stream7 Channel3
+    BSP_DMA_REQ_TIM2_CH4_ALT,   ///<! DMA1 Stream7 Channel3
+    BSP_DMA_REQ_UART5_RX,       ///<! DMA1 Stream0 Channel4
+    BSP_DMA_REQ_USART3_RX,      ///<! DMA1 Stream1 Channel4
+    BSP_DMA_REQ_UART4_RX,       ///<! DMA1 Stream2 Channel4
+    BSP_DMA_REQ_USART3_TX,      ///<! DMA1 Stream3 Channel4
+    BSP_DMA_REQ_UART4_TX,       ///<! DMA1 Stream4 Channel4
+    BSP_DMA_REQ_USART2_RX,      ///<! DMA1 Stream5 Channel4
+    BSP_DMA_REQ_USART2_TX,      ///<! DMA1 Stream6 Channel4
+    BSP_DMA_REQ_UART5_TX,       ///<! DMA1 Stream7 Channel4
+    BSP_DMA_REQ_TIM3_CH4,       ///<! DMA1 Stream2 Channel5
+    BSP_DMA_REQ_TIM3_UP,        ///<! DMA1 Stream2 Channel5
+    BSP_DMA_REQ_TIM3_CH1,       ///<! DMA1 Stream4 Channel5
+    BSP_DMA_REQ_TIM3_TRIG,      ///<! DMA1 Stream4 Channel5
+    BSP_DMA_REQ_TIM3_CH2,       ///<! DMA1 Stream5 Channel5
+    BSP_DMA_REQ_TIM3_CH3,       ///<! DMA1 Stream7 Channel5
+    BSP_DMA_REQ_TIM5_CH3,       ///<! DMA1 Stream0 Channel6
+    BSP_DMA_REQ_TIM5_UP,        ///<! DMA1 Stream0 Channel6
+    BSP_DMA_REQ_TIM5_CH4,       ///<! DMA1 Stream1 Channel6
+    BSP_DMA_REQ_TIM5_TRIG,      ///<! DMA1 Stream1 Channel6
+    BSP_DMA_REQ_TIM5_CH1,       ///<! DMA1 Stream2 Channel6
+    BSP_DMA_REQ_TIM5_CH4_ALT,   ///<! DMA1 Stream3 Channel6
+    BSP_DMA_REQ_TIM5_TRIG_ALT,  ///<! DMA1 Stream3 Channel6
+    BSP_DMA_REQ_TIM5_CH2,       ///<! DMA1 Stream4 Channel6
+    BSP_DMA_REQ_TIM5_UP_ALT,    ///<! DMA1 Stream6 Channel6
+    BSP_DMA_REQ_TIM6_UP,        ///<! DMA1 Stream1 Channel7
+    BSP_DMA_REQ_I2C2_RX,        ///<! DMA1 Stream2 Channel7
+    BSP_DMA_REQ_I2C2_RX_ALT,    ///<! DMA1 Stream3 Channel7
+    BSP_DMA_REQ_USART3_TX_ALT,  ///<! DMA1 Stream4 Channel7
+    BSP_DMA_REQ_DAC1,           ///<! DMA1 Stream5 Channel7
+    BSP_DMA_REQ_DAC2,           ///<! DMA1 Stream6 Channel7
+    BSP_DMA_REQ_I2C2_TX,        ///<! DMA1 Stream7 Channel7
+    BSP_DMA_REQ_ADC1,           ///<! DMA2 Stream0 Channel0
+    BSP_DMA_REQ_ADC1_ALT,       ///<! DMA2 Stream4 Channel0
+    BSP_DMA_REQ_SAI1_A,         ///<! DMA2 Stream1 Channel0
+    BSP_DMA_REQ_SAI1_A_ALT,     ///<! DMA2 Stream3 Channel0
+    BSP_DMA_REQ_SAI1_B,         ///<! DMA2 Stream5 Channel0
+    BSP_DMA_REQ_SAI2_B,         ///<! DMA2 Stream7 Channel0
+    BSP_DMA_REQ_TIM8_CH123,     ///<! DMA2 Stream2 Channel0, CH1, CH2 and CH3
+    BSP_DMA_REQ_TIM1_CH123,     ///<! DMA2 Stream6 Channel0, CH1, CH2 and CH3
+    BSP_DMA_REQ_ADC2,           ///<! DMA2 Stream2 Channel1
+    BSP_DMA_REQ_ADC2_ALT,       ///<! DMA2 Stream3 Channel1
+    BSP_DMA_REQ_DCMI,           ///<! DMA2 Stream1 Channel1
+    BSP_DMA_REQ_DCMI_ALT,       ///<! DMA2 Stream7 Channel1
+    BSP_DMA_REQ_SAI1_B_ALT,     ///<! DMA2 Stream4 Channel1
+    BSP_DMA_REQ_ADC3,           ///<! DMA2 Stream0 Channel2
+    BSP_DMA_REQ_ADC3_ALT,       ///<! DMA2 Stream1 Channel2
+    BSP_DMA_REQ_SPI1_RX,        ///<! DMA2 Stream0 Channel3
+    BSP_DMA_REQ_SPI1_RX_ALT,    ///<! DMA2 Stream2 Channel3
+    BSP_DMA_REQ_SPI1_TX,        ///<! DMA2 Stream3 Channel3
+    BSP_DMA_REQ_SPI1_TX_ALT,    ///<! DMA2 Stream5 Channel3
+    BSP_DMA_REQ_SAI2_A,         ///<! DMA2 Stream4 Channel3
+    BSP_DMA_REQ_SAI2_B_ALT,     ///<! DMA2 Stream6 Channel3
+    BSP_DMA_REQ_QUADSPI,        ///<! DMA2 Stream7 Channel3
+    BSP_DMA_REQ_SPI4_RX,        ///<! DMA2 Stream0 Channel4
+    BSP_DMA_REQ_SPI4_TX,        ///<! DMA2 Stream1 Channel4
+    BSP_DMA_REQ_USART1_RX,      ///<! DMA2 Stream2 Channel4
+    BSP_DMA_REQ_SDIO,           ///<! DMA2 Stream3 Channel4
+    BSP_DMA_REQ_USART1_RX_ALT,  ///<! DMA2 Stream5 Channel4
+    BSP_DMA_REQ_SDIO_ALT,       ///<! DMA2 Stream6 Channel4
+    BSP_DMA_REQ_USART1_TX,      ///<! DMA2 Stream7 Channel4
+    BSP_DMA_REQ_USART6_RX,      ///<! DMA2 Stream1 Channel5
+    BSP_DMA_REQ_USART6_RX_ALT,  ///<! DMA2 Stream2 Channel5
+    BSP_DMA_REQ_SPI4_RX_ALT,    ///<! DMA2 Stream3 Channel5
+    BSP_DMA_REQ_SPI4_TX_ALT,    ///<! DMA2 Stream4 Channel5
+    BSP_DMA_REQ_USART6_TX,      ///<! DMA2 Stream6 Channel5
+    BSP_DMA_REQ_USART6_TX_ALT,  ///<! DMA2 Stream7 Channel5
+    BSP_DMA_REQ_TIM1_TRIG,      ///<! DMA2 Stream0 Channel6
+    BSP_DMA_REQ_TIM1_CH1,       ///<! DMA2 Stream1 Channel6
+    BSP_DMA_REQ_TIM1_CH2,       ///<! DMA2 Stream2 Channel6
+    BSP_DMA_REQ_TIM1_CH1_ALT,   ///<! DMA2 Stream3 Channel6
+    BSP_DMA_REQ_TIM1_CH4,       ///<! DMA2 Stream4 Channel6
+    BSP_DMA_REQ_TIM1_COM,       ///<! DMA2 Stream4 Channel6
+    BSP_DMA_REQ_TIM1_TRIG_ALT,  ///<! DMA2 Stream4 Channel6
+    BSP_DMA_REQ_TIM1_UP,        ///<! DMA2 Stream5 Channel6
+    BSP_DMA_REQ_TIM1_CH3,       ///<! DMA2 Stream6 Channel6
+    BSP_DMA_REQ_TIM8_UP,        ///<! DMA2 Stream1 Channel7
+    BSP_DMA_REQ_TIM8_CH1,       ///<! DMA2 Stream2 Channel7
+    BSP_DMA_REQ_TIM8_CH2,       ///<! DMA2 Stream3 Channel7
+    BSP_DMA_REQ_TIM8_CH3,       ///<! DMA2 Stream4 Channel7
+    BSP_DMA_REQ_TIM8_CH4,       ///<! DMA2 Stream7 Channel7
+    BSP_DMA_REQ_TIM8_TRIG,      ///<! DMA2 Stream7 Channel7
+    BSP_DMA_REQ_TIM8_COM,       ///<! DMA2 Stream7 Channel7
+    BSP_DMA_REQ_M2M_S0,         ///<! DMA2 Stream0, memory to memory
+    BSP_DMA_REQ_M2M_S1,         ///<! DMA2 Stream1, memory to memory
+    BSP_DMA_REQ_M2M_S2,         ///<! DMA2 Stream2, memory to memory
+    BSP_DMA_REQ_M2M_S3,         ///<! DMA2 Stream3, memory to memory
+    BSP_DMA_REQ_M2M_S4,         ///<! DMA2 Stream4, memory to memory
+    BSP_DMA_REQ_M2M_S5,         ///<! DMA2 Stream5, memory to memory
+    BSP_DMA_REQ_M2M_S6,         ///<! DMA2 Stream6, memory to memory
+    BSP_DMA_REQ_M2M_S7,         ///<! DMA2 Stream7, memory to memory
+    BSP_DMA_REQ_CNT
+
+} bspDmaReq_t;
+
+/**
+ * @brief The location of a request.
+ */
+typedef struct
+{
+    uint8_t Dma;                    ///<! 1 or 2
+    uint8_t Stream;                 ///<! 0..7
+    uint8_t Channel;                ///<! 0..7
+
+} bspDmaMap_t;
+
+/**
+ * @brief Maps the requests to streams and channels, order as in bspDmaReq_t.
+ */
+static constexpr bspDmaMap_t bspDmaMap[] =
+{
+    {1, 0, 0},                    /* SPI3_RX */
+    {1, 2, 0},                    /* SPI3_RX_ALT */
+    {1, 3, 0},                    /* SPI2_RX */
+    {1, 4, 0},                    /* SPI2_TX */
+    {1, 5, 0},                    /* SPI3_TX */
+    {1, 7, 0},                    /* SPI3_TX_ALT */
+    {1, 1, 0},                    /* SPDIFRX_DT */
+    {1, 6, 0},                    /* SPDIFRX_CS */
+    {1, 0, 1},                    /* I2C1_RX */
+    {1, 5, 1},                    /* I2C1_RX_ALT */
+    {1, 6, 1},                    /* I2C1_TX */
+    {1, 7, 1},                    /* I2C1_TX_ALT */
+    {1, 2, 1},                    /* TIM7_UP */
+    {1, 4, 1},                    /* TIM7_UP_ALT */
+    {1, 0, 2},                    /* TIM4_CH1 */
+    {1, 3, 2},                    /* TIM4_CH2 */
+    {1, 6, 2},                    /* TIM4_UP */
+    {1, 7, 2},                    /* TIM4_CH3 */
+    {1, 2, 3},                    /* I2C3_RX */
+    {1, 4, 3},                    /* I2C3_TX */
+    {1, 1, 3},                    /* TIM2_UP */
+    {1, 1, 3},                    /* TIM2_CH3 */
+    {1, 5, 3},                    /* TIM2_CH1 */
+    {1, 6, 3},                    /* TIM2_CH2 */
+    {1, 6, 3},                    /* TIM2_CH4 */
+    {1, 7, 3},                    /* TIM2_UP_ALT */
+    {1, 7, 3},                    /* TIM2_CH4_ALT */
+    {1, 0, 4},                    /* UART5_RX */
+    {1, 1, 4},                    /* USART3_RX */
+    {1, 2, 4},                    /* UART4_RX */
+    {1, 3, 4},                    /* USART3_TX */
+    {1, 4, 4},                    /* UART4_TX */
+    {1, 5, 4},                    /* USART2_RX */
+    {1, 6, 4},                    /* USART2_TX */
+    {1, 7, 4},                    /* UART5_TX */
+    {1, 2, 5},                    /* TIM3_CH4 */
+    {1, 2, 5},                    /* TIM3_UP */
+    {1, 4, 5},                    /* TIM3_CH1 */
+    {1, 4, 5},                    /* TIM3_TRIG */
+    {1, 5, 5},                    /* TIM3_CH2 */
+    {1, 7, 5},                    /* TIM3_CH3 */
+    {1, 0, 6},                    /* TIM5_CH3 */
+    {1, 0, 6},                    /* TIM5_UP */
+    {1, 1, 6},                    /* TIM5_CH4 */
+    {1, 1, 6},                    /* TIM5_TRIG */
+    {1, 2, 6},                    /* TIM5_CH1 */
+    {1, 3, 6},                    /* TIM5_CH4_ALT */
+    {1, 3, 6},                    /* TIM5_TRIG_ALT */
+    {1, 4, 6},                    /* TIM5_CH2 */
+    {1, 6, 6},                    /* TIM5_UP_ALT */
+    {1, 1, 7},                    /* TIM6_UP */
+    {1, 2, 7},                    /* I2C2_RX */
+    {1, 3, 7},                    /* I2C2_RX_ALT */
+    {1, 4, 7},                    /* USART3_TX_ALT */
+    {1, 5, 7},                    /* DAC1 */
+    {1, 6, 7},                    /* DAC2 */
+    {1, 7, 7},                    /* I2C2_TX */
+    {2, 0, 0},                    /* ADC1 */
+    {2, 4, 0},                    /* ADC1_ALT */
+    {2, 1, 0},                    /* SAI1_A */
+    {2, 3, 0},                    /* SAI1_A_ALT */
+    {2, 5, 0},                    /* SAI1_B */
+    {2, 7, 0},                    /* SAI2_B */
+    {2, 2, 0},                    /* TIM8_CH123 */
+    {2, 6, 0},                    /* TIM1_CH123 */
+    {2, 2, 1},                    /* ADC2 */
+    {2, 3, 1},                    /* ADC2_ALT */
+    {2, 1, 1},                    /* DCMI */
+    {2, 7, 1},                    /* DCMI_ALT */
+    {2, 4, 1},                    /* SAI1_B_ALT */
+    {2, 0, 2},                    /* ADC3 */
+    {2, 1, 2},                    /* ADC3_ALT */
+    {2, 0, 3},                    /* SPI1_RX */
+    {2, 2, 3},                    /* SPI1_RX_ALT */
+    {2, 3, 3},                    /* SPI1_TX */
+    {2, 5, 3},                    /* SPI1_TX_ALT */
+    {2, 4, 3},                    /* SAI2_A */
+    {2, 6, 3},                    /* SAI2_B_ALT */
+    {2, 7, 3},                    /* QUADSPI */
+    {2, 0, 4},                    /* SPI4_RX */
+    {2, 1, 4},                    /* SPI4_TX */
+    {2, 2, 4},                    /* USART1_RX */
+    {2, 3, 4},                    /* SDIO */
+    {2, 5, 4},                    /* USART1_RX_ALT */
+    {2, 6, 4},                    /* SDIO_ALT */
+    {2, 7, 4},                    /* USART1_TX */
+    {2, 1, 5},                    /* USART6_RX */
+    {2, 2, 5},                    /* USART6_RX_ALT */
+    {2, 3, 5},                    /* SPI4_RX_ALT */
+    {2, 4, 5},                    /* SPI4_TX_ALT */
+    {2, 6, 5},                    /* USART6_TX */
+    {2, 7, 5},                    /* USART6_TX_ALT */
+    {2, 0, 6},                    /* TIM1_TRIG */
+    {2, 1, 6},                    /* TIM1_CH1 */
+    {2, 2, 6},                    /* TIM1_CH2 */
+    {2, 3, 6},                    /* TIM1_CH1_ALT */
+    {2, 4, 6},                    /* TIM1_CH4 */
+    {2, 4, 6},                    /* TIM1_COM */
+    {2, 4, 6},                    /* TIM1_TRIG_ALT */
+    {2, 5, 6},                    /* TIM1_UP */
+    {2, 6, 6},                    /* TIM1_CH3 */
+    {2, 1, 7},                    /* TIM8_UP */
+    {2, 2, 7},                    /* TIM8_CH1 */
+    {2, 3, 7},                    /* TIM8_CH2 */
+    {2, 4, 7},                    /* TIM8_CH3 */
+    {2, 7, 7},                    /* TIM8_CH4 */
+    {2, 7, 7},                    /* TIM8_TRIG */
+    {2, 7, 7},                    /* TIM8_COM */
+    {2, 0, 0},                    /* M2M_S0 */
+    {2, 1, 0},                    /* M2M_S1 */
+    {2, 2, 0},                    /* M2M_S2 */
+    {2, 3, 0},                    /* M2M_S3 */
+    {2, 4, 0},                    /* M2M_S4 */
+    {2, 5, 0},                    /* M2M_S5 */
+    {2, 6, 0},                    /* M2M_S6 */
+    {2, 7, 0},                    /* M2M_S7 */
+};
+
+static_assert(sizeof(bspDmaMap) / sizeof(bspDmaMap[0]) == BSP_DMA_REQ_CNT,
+    "bspDmaMap does not match bspDmaReq_t");
+
+/**
+ * @brief The interrupt flags of a stream as passed to the handler. 
+ */
+#define BSP_DMA_FLAG_FE                     0x01
+#define BSP_DMA_FLAG_DME                    0x04
+#define BSP_DMA_FLAG_TE                     0x08
+#define BSP_DMA_FLAG_HT                     0x10
+#define BSP_DMA_FLAG_TC                     0x20
+#define BSP_DMA_FLAG_ALL                    0x3D
+
+/**
+ * @brief The stream interrupt handler.
+ * 
+ * @param flags     The BSP_DMA_FLAG_x flags of the stream, already cleared.
+ * @param pCtx      The context passed to bspDmaClaim().
+ */
+typedef void (*bspDmaIsr_t)(uint32_t flags, void *pCtx);
+
+/**
+ * @brief Used to check if two requests use the same stream.
+ */
+static constexpr bool bspDmaConflict(bspDmaReq_t a, bspDmaReq_t b)
+{
+    return bspDmaMap[a].Dma == bspDmaMap[b].Dma && 
+        bspDmaMap[a].Stream == bspDmaMap[b].Stream;
+}
+
+/**
+ * @brief Used to check at compile time that the given requests do not share
+ * a stream.
+ * 
+ * @param pReq      The requests.
+ * @param cnt       Number of requests.
+ * 
+ * @return  true if all requests use different streams.
+ */
+static constexpr bool bspDmaUnique(const bspDmaReq_t *pReq, uint32_t cnt)
+{
+    for (uint32_t i = 0; i < cnt; i++)
+    {
+        for (uint32_t j = i + 1; j < cnt; j++)
+        {
+            if (bspDmaConflict(pReq[i], pReq[j]))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Used to get the stream of a request as LL_DMA_STREAM_x.
+ */
+static constexpr uint32_t bspDmaGetStream(bspDmaReq_t req)
+{
+    return bspDmaMap[req].Stream;
+}
+
+/**
+ * @brief Used to get the channel of a request as LL_DMA_CHANNEL_x.
+ */
+static constexpr uint32_t bspDmaGetChannel(bspDmaReq_t req)
+{
+    return (uint32_t) bspDmaMap[req].Channel << DMA_SxCR_CHSEL_Pos;
+}
+
+/**
+ * @brief Used to get the interrupt of the stream of a request.
+ */
+static constexpr IRQn_Type bspDmaGetIrq(bspDmaReq_t req)
+{
+    return bspDmaMap[req].Dma == 1 ?
+        (bspDmaMap[req].Stream < 7 ? 
+            (IRQn_Type)(DMA1_Stream0_IRQn + bspDmaMap[req].Stream) :
+            DMA1_Stream7_IRQn) :
+        (bspDmaMap[req].Stream < 5 ? 
+            (IRQn_Type)(DMA2_Stream0_IRQn + bspDmaMap[req].Stream) :
+            (IRQn_Type)(DMA2_Stream5_IRQn + bspDmaMap[req].Stream - 5));
+}
+
+/**
+ * @brief Used to get the controller of a request.
+ */
+static inline DMA_TypeDef *bspDmaGetDma(bspDmaReq_t req)
+{
+    return bspDmaMap[req].Dma == 1 ? DMA1 : DMA2;
+}
+
+/**
+ * @brief Used to get the bit position of the flags of a stream in the 
+ * LISR/HISR and LIFCR/HIFCR registers.
+ */
+static constexpr uint32_t bspDmaFlagPos(uint32_t stream)
+{
+    return ((stream & 0x02) ? 16 : 0) + ((stream & 0x01) ? 6 : 0);
+}
+
+/**
+ * @brief Used to read the BSP_DMA_FLAG_x flags of the stream of a request.
+ */
+static inline uint32_t bspDmaGetFlags(bspDmaReq_t req)
+{
+    DMA_TypeDef *pDma = bspDmaGetDma(req);
+    uint32_t stream = bspDmaGetStream(req);
+    uint32_t isr = stream < 4 ? pDma->LISR : pDma->HISR;
+
+    return (isr >> bspDmaFlagPos(stream)) & BSP_DMA_FLAG_ALL;
+}
+
+/**
+ * @brief Used to clear the given BSP_DMA_FLAG_x flags of the stream of a 
+ * request.
+ */
+static inline void bspDmaClearFlags(bspDmaReq_t req, uint32_t flags)
+{
+    DMA_TypeDef *pDma = bspDmaGetDma(req);
+    uint32_t stream = bspDmaGetStream(req);
+
+    flags = (flags & BSP_DMA_FLAG_ALL) << bspDmaFlagPos(stream);
+
+    if (stream < 4)
+        WRITE_REG(pDma->LIFCR, flags);
+    else
+        WRITE_REG(pDma->HIFCR, flags);
+}
+
+/**
+ * @brief Used to claim the stream of a request.
+ * 
+ * If a handler is given the stream interrupt is enabled with the given 
+ * priority. Hence that the interrupts of the stream itself have to be 
+ * enabled by the driver.
+ *
+ * @param req       The request.
+ * @param isr       The interrupt handler, may be NULL.
+ * @param pCtx      Passed to the handler.
+ * @param prio      The interrupt priority.
+ * 
+ * @return  BSP_EEINVAL if the request is invalid, BSP_EBUSY if the stream
+ *          is in use, BSP_OK otherwise.
+ */
+bspStatus_t bspDmaClaim(bspDmaReq_t req, bspDmaIsr_t isr, void *pCtx, 
+    uint32_t prio);
+
+/**
+ * @brief Used to release a stream claimed by bspDmaClaim().
+ * 
+ * Stops the stream and disables its interrupt.
+ *
+ * @param req       The request used to claim the stream.
+ */
+void bspDmaRelease(bspDmaReq_t req);
+
+/**
+ * @brief Used to check if the stream of a request is claimed.
+ *
+ * @param req       The request.
+ * 
+ * @return  true if the stream is in use.
+ */
+bool bspDmaIsClaimed(bspDmaReq_t req);
+
+/**
+ * @brief Used to stop the stream of a request.
+ * 
+ * Disables the stream, waits until the ongoing transfer has ended, clears 
+ * all flags and a pending interrupt.
+ *
+ * @param req       The request.
+ */
+void bspDmaStop(bspDmaReq_t req);
+
+#if BSP_DMA_M2M == BSP_ENABLED
+
+/**
+ * Asynchronous memory copy and fill.
+ * 
+ * Transfers are queued and executed one after the other by the DMA2 stream
+ * of BSP_DMA_M2M_REQ, the callback is called from its interrupt once a 
+ * transfer has completed. Words and bursts of four words are used where 
+ * the alignment of the buffers allows it, transfers above the 65535 items 
+ * of a stream are split into chunks.
+ * 
+ * Transfers below BSP_DMA_M2M_MIN bytes are done by the CPU right away if 
+ * nothing is queued, the callback is called before the function returns.
+ * 
+ * Hence that the memory to memory stream competes with all other streams of
+ * DMA2 for the bus, it runs at low priority.
+ */
+
+#ifndef BSP_DMA_M2M_REQ
+
+/**
+ * @brief The stream used, one of BSP_DMA_REQ_M2M_Sx. Has to be changed if
+ * the stream is needed by a peripheral, see BSP_DMA_USER_REQS.
+ */
+#define BSP_DMA_M2M_REQ                     BSP_DMA_REQ_M2M_S0
+
+#endif
+
+#ifndef BSP_DMA_M2M_QUEUE
+
+/**
+ * @brief Number of transfers which can be queued, has to be a power of two.
+ */
+#define BSP_DMA_M2M_QUEUE                   8
+
+#endif
+
+#ifndef BSP_DMA_M2M_MIN
+
+/**
+ * @brief Transfers below this number of bytes are done by the CPU.
+ */
+#define BSP_DMA_M2M_MIN                     64
+
+#endif
+
+/**
+ * @brief Called once a transfer has completed.
+ * 
+ * @param pCtx      The context passed with the transfer.
+ */
+typedef void (*bspDmaM2MCb_t)(void *pCtx);
+
+/**
+ * @brief Used to initialize the memory to memory transfers, called by 
+ * bspChipInit().
+ */
+void bspDmaM2MInit(void);
+
+/**
+ * @brief Used to copy memory asynchronously.
+ * 
+ * The buffers must not overlap and have to stay valid until the transfer 
+ * has completed.
+ *
+ * @param pDst      The destination.
+ * @param pSrc      The source.
+ * @param len       The number of bytes.
+ * @param cb        Called once done, may be NULL.
+ * @param pCtx      Passed to the callback.
+ * @param pId       Where to store the ID of the transfer, may be NULL.
+ * 
+ * @return  BSP_EEINVAL in case of invalid arguments, BSP_EBUSY if the queue
+ *          is full, BSP_OK otherwise.
+ */
+bspStatus_t bspDmaMemcpyAsync(void *pDst, const void *pSrc, uint32_t len, 
+    bspDmaM2MCb_t cb, void *pCtx, uint32_t *pId);
+
+/**
+ * @brief Used to fill memory asynchronously.
+ * 
+ * See bspDmaMemcpyAsync().
+ *
+ * @param pDst      The destination.
+ * @param val       The value to fill with.
+ * @param len       The number of bytes.
+ * @param cb        Called once done, may be NULL.
+ * @param pCtx      Passed to the callback.
+ * @param pId       Where to store the ID of the transfer, may be NULL.
+ * 
+ * @return  BSP_EEINVAL in case of invalid arguments, BSP_EBUSY if the queue
+ *          is full, BSP_OK otherwise.
+ */
+bspStatus_t bspDmaMemsetAsync(void *pDst, uint8_t val, uint32_t len, 
+    bspDmaM2MCb_t cb, void *pCtx, uint32_t *pId);
+
+/**
+ * @brief Used to poll for the completion of a transfer.
+ *
+ * @param id        The ID returned when the transfer has been queued.
+ * 
+ * @return  true if the transfer has completed.
+ */
+bool bspDmaM2MIsDone(uint32_t id);
+
+/**
+ * @brief Used to check if all queued transfers have completed.
+ * 
+ * @return  true if there is nothing left to do.
+ */
+bool bspDmaM2MIsIdle(void);
+
+#endif /* BSP_DMA_M2M == BSP_ENABLED */
+
+#endif /* BSP_NUCLEO_F446_DMA_H_ */
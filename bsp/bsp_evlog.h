@@ -0,0 +1,94 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+
+#ifndef BSP_NUCLEO_F446_EVLOG_H_
+#define BSP_NUCLEO_F446_EVLOG_H_
+
+#include "bsp/bsp.h"
+
+#include <stdint.h>
+
+/**
+ * Persistent event log.
+ *
+ * Events are appended to a ring in the backup SRAM which survives resets,
+ * so the last BSP_EVLOG_SIZE events before a crash or a watchdog reset can
+ * be dumped at the next boot. Each entry takes 12 bytes: a time stamp, a 16
+ * bit event ID, a 16 bit sequence number and a 32 bit argument.
+ *
+ * bspEvLog() claims a slot by LDREX/STREX and writes the sequence number
+ * last, so it can be called from any context in constant time and entries
+ * torn by a reset are detected and skipped by the dump.
+ */
+
+#if BSP_EVLOG == BSP_ENABLED
+
+#ifndef BSP_EVLOG_SIZE
+
+/**
+ * @brief Number of entries, has to be a power of two.
+ */
+#define BSP_EVLOG_SIZE                      128
+
+#endif
+
+/**
+ * @brief Event IDs used by the bsp, the application may use all below.
+ */
+#define BSP_EVLOG_ID_BOOT                   0xFFFF
+#define BSP_EVLOG_ID_WDG                    0xFFFE
+
+/**
+ * @brief Used to initialize the log, called by bspChipInit().
+ *
+ * The entries of the previous run are kept, the log is only cleared if its
+ * header is invalid, e.g. after power up. A BSP_EVLOG_ID_BOOT event with the
+ * reset flags of RCC->CSR as argument separates the runs, the flags are
+ * cleared afterwards if BSP_CRASH is disabled.
+ */
+void bspEvLogInit(void);
+
+/**
+ * @brief Used to append a event, can be called from any context.
+ *
+ * The time stamp is the sys tick in ms or, if BSP_EVLOG_CYCLES is enabled
+ * or the sys tick is not, the cycle counter.
+ *
+ * @param id        The event ID.
+ * @param arg       The argument.
+ */
+void bspEvLog(uint16_t id, uint32_t arg);
+
+/**
+ * @brief Used to print all valid entries to stdout, oldest first.
+ */
+void bspEvLogDump(void);
+
+/**
+ * @brief Used to drop all entries.
+ */
+void bspEvLogClear(void);
+
+#endif /* BSP_EVLOG == BSP_ENABLED */
+
+#endif /* BSP_NUCLEO_F446_EVLOG_H_ */
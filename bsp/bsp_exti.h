@@ -29,10 +29,170 @@
 #include <stdbool.h>
 
 #include "bsp/bsp.h"
+#include "bsp/bsp_gpio.h"
+
+/**
+ * @brief The edges a external interrupt can be triggered on.
+ */
+typedef enum
+{
+   BSP_EXTI_RISING = 1,             ///<! Rising edge
+   BSP_EXTI_FALLING = 2,            ///<! Falling edge
+   BSP_EXTI_BOTH = 3                ///<! Both edges
+
+} bspExtiEdge_t;
+
+/**
+ * @brief Called from the interrupt of a line attached by bspExtiAttach().
+ * 
+ * @param pCtx    The context pointer passed to bspExtiAttach().
+ */
+typedef void (*bspExtiCb_t)(void *pCtx);
 
 /**
  * @brief Used to initslize the external interrupts
+ * 
+ * Hence that the user button is attached to line 13 and will call 
+ * bspButtonIrqCb(), unless it is handled by bsp_debounce.h.
  */
 void bspExtiInit(void);
 
+/**
+ * @brief Used to attach a callback to the external interrupt of the given 
+ * pin. 
+ * 
+ * There are 16 lines, line n can be connected to pin n of any port. The 
+ * lines 0 to 4 have their own interrupt vector, 5 to 9 and 10 to 15 share 
+ * one. Shared vectors find the pending lines by a bit scan, so the cost of 
+ * the dispatch does not depend on the number of attached lines.
+ *
+ * @param pin     The bsp gpio pin ID, has to refer to a single pin.
+ * @param edge    The edge(s) to trigger on.
+ * @param cb      The callback.
+ * @param pCtx    Passed to the callback.
+ * 
+ * @return  BSP_OK on success.
+ *          BSP_EBUSY if the line is already attached.
+ *          BSP_EEINVAL in case of invalid arguments.
+ */
+bspStatus_t bspExtiAttach(bspGpioPin_t pin, bspExtiEdge_t edge, 
+      bspExtiCb_t cb, void *pCtx);
+
+/**
+ * @brief Used to detach the external interrupt of the given pin.
+ *
+ * @param pin     The bsp gpio pin ID used with bspExtiAttach().
+ */
+void bspExtiDetach(bspGpioPin_t pin);
+
+#if BSP_EXTI_CAPTURE == BSP_ENABLED
+
+#ifndef BSP_EXTI_CAPTURE_NUM
+
+/**
+ * @brief Number of lines which can be attached in capture mode at once.
+ */
+#define BSP_EXTI_CAPTURE_NUM                 4
+
+#endif
+
+#ifndef BSP_EXTI_CAPTURE_SIZE
+
+/**
+ * @brief Number of events per line, has to be a power of two.
+ */
+#define BSP_EXTI_CAPTURE_SIZE                64
+
+#endif
+
+/**
+ * @brief A captured edge.
+ */
+typedef struct
+{
+   uint32_t Time;                   ///<! DWT cycle counter at isr entry
+   uint32_t Level;                  ///<! Pin level at isr entry, 0 or 1
+
+} bspExtiEvent_t;
+
+/**
+ * @brief Statistics derived from a sequence of captured edges, all times 
+ * in cycles of the core clock.
+ * 
+ * The first event defines the reference edge, periods are measured from one
+ * reference edge to the next. The high time is only known if both edges 
+ * have been captured, otherwise it is 0 as the duty cycle.
+ */
+typedef struct
+{
+   uint32_t Periods;                ///<! Number of full periods
+   uint32_t PeriodMin;
+   uint32_t PeriodMax;
+   uint32_t PeriodMean;
+   uint32_t HighMean;               ///<! Mean high time
+   uint32_t FreqMilliHz;            ///<! Frequency in mHz
+   uint32_t DutyPermille;           ///<! Duty cycle in 1/1000
+
+} bspExtiStats_t;
+
+/**
+ * @brief Used to attach the given pin in capture mode. 
+ * 
+ * The cycle counter is read at the very beginning of the isr, the pin level
+ * right after. Both are written to a lock free ring buffer of the line which 
+ * can be read by bspExtiRead(), so nothing but the isr entry latency is 
+ * between the edge and the time stamp. Hence that all lines of a shared 
+ * vector pending at the same time get the same time stamp.
+ *
+ * @param pin     The bsp gpio pin ID, has to refer to a single pin.
+ * @param edge    The edge(s) to trigger on.
+ * @param cb      Optional callback called after each capture, may be NULL.
+ * @param pCtx    Passed to the callback.
+ * 
+ * @return  BSP_OK on success.
+ *          BSP_EBUSY if the line is already attached or if there is no 
+ *          free ring buffer, see BSP_EXTI_CAPTURE_NUM.
+ *          BSP_EEINVAL in case of invalid arguments.
+ */
+bspStatus_t bspExtiAttachCapture(bspGpioPin_t pin, bspExtiEdge_t edge, 
+      bspExtiCb_t cb, void *pCtx);
+
+/**
+ * @brief Used to read the captured events of the given pin. 
+ * 
+ * Must not be called from more than one context at once for the same pin.
+ *
+ * @param pin     The bsp gpio pin ID used with bspExtiAttachCapture().
+ * @param pEv     Where to store the events, oldest first.
+ * @param max     The maximum number of events to read.
+ *
+ * @return  The number of events read.
+ */
+uint32_t bspExtiRead(bspGpioPin_t pin, bspExtiEvent_t *pEv, uint32_t max);
+
+/**
+ * @brief Used to get the number of events lost due to a full ring buffer.
+ *
+ * @param pin     The bsp gpio pin ID used with bspExtiAttachCapture().
+ * 
+ * @return  The number of events lost since attaching the pin.
+ */
+uint32_t bspExtiGetLost(bspGpioPin_t pin);
+
+/**
+ * @brief Used to derive period, frequency and duty cycle from the given 
+ * events, e.g. read by bspExtiRead().
+ *
+ * @param pEv     The events, oldest first.
+ * @param cnt     The number of events.
+ * @param pStats  Where to store the results.
+ * 
+ * @return  BSP_OK on success.
+ *          BSP_EEMPTY if there is not a single full period.
+ */
+bspStatus_t bspExtiCalcStats(const bspExtiEvent_t *pEv, uint32_t cnt, 
+      bspExtiStats_t *pStats);
+
+#endif /* BSP_EXTI_CAPTURE == BSP_ENABLED */
+
 #endif /* BSP_MOTORCTRL_EXTI_H_ */
\ No newline at end of file
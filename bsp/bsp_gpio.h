@@ -26,6 +26,7 @@
 #include <stm32f4xx_ll_gpio.h>
 
 #include <stdint.h>
+#include <stddef.h>
 #include <stdbool.h>
 
 #include "bsp/bsp.h"
@@ -56,6 +57,36 @@
  */
 #define BSP_IOMAPVAL(_port, _pin)           ((_port << 16) + _pin)
 
+/**
+ * @brief Derives the gpio port from the bsp gipo pin ID.
+ */
+#define BSP_IOMAPPORT(_val)                                                 \
+                                                                            \
+    ((GPIO_TypeDef *) (AHB1PERIPH_BASE + (((uint32_t)_val) >> 16)))
+
+/**
+ * @brief Derives the bit mask for enabling the gpio clock from the bsp gpio 
+ * pin ID.
+ */
+#define BSP_IOMAPPEN(_val)                  (0x1 << (((uint32_t)_val) >> 26))
+
+/**
+ * @brief Derives the index of the gpio port (A = 0, B = 1, ...) from the bsp 
+ * gpio pin ID.
+ */
+#define BSP_IOMAPIDX(_val)                  (((uint32_t)_val) >> 26)
+
+/**
+ * @brief Number of gpio ports, A to H.
+ */
+#define BSP_GPIO_NUMPORTS                   8
+
+/**
+ * @brief Derives the bit mask for accessing the gpio pin from the bsp gpio 
+ * pin ID.
+ */
+#define BSP_IOMAPPIN(_val)                  (((uint32_t)_val) & 0xFFFF)
+
 /**
  * @brief Descriptor of all gpio pins. Hence that some of those names might be
  * overwritten in bsp.h as there special function pins names will be mapped
@@ -218,10 +249,136 @@ typedef enum
  */
 void bspGpioPinInit(bspGpioPin_t pin, LL_GPIO_InitTypeDef *init);
 
+/**
+ * @brief Configuration of a single entry of a pin table, the members are 
+ * the same as of LL_GPIO_InitTypeDef.
+ */
+typedef struct
+{
+    bspGpioPin_t Pin;           ///<! The bsp gpio pin ID
+    uint32_t Mode;              ///<! LL_GPIO_MODE_x
+    uint32_t Speed;             ///<! LL_GPIO_SPEED_FREQ_x
+    uint32_t OutputType;        ///<! LL_GPIO_OUTPUT_x
+    uint32_t Pull;              ///<! LL_GPIO_PULL_x
+    uint32_t Alternate;         ///<! LL_GPIO_AF_x
+    uint32_t Level;             ///<! Initial output level, 0 or 1
+
+} bspGpioCfg_t;
+
+/**
+ * @brief Register values of a single port derived from a pin table. Every 
+ * register comes with a mask of the bits to modify.
+ */
+typedef struct
+{
+    uint32_t Moder;
+    uint32_t ModerMsk;
+    uint32_t Otyper;
+    uint32_t OtyperMsk;
+    uint32_t Ospeedr;
+    uint32_t OspeedrMsk;
+    uint32_t Pupdr;
+    uint32_t PupdrMsk;
+    uint32_t Afr[2];
+    uint32_t AfrMsk[2];
+    uint32_t Bsrr;
+
+} bspGpioPortCfg_t;
+
+/**
+ * @brief Register values of all ports derived from a pin table.
+ */
+typedef struct
+{
+    uint32_t ClkEn;             ///<! Mask for RCC->AHB1ENR
+    bspGpioPortCfg_t Port[BSP_GPIO_NUMPORTS];
+
+} bspGpioBatch_t;
+
+/**
+ * @brief Folds the given pin table into per port register values. 
+ * 
+ * Meant to be evaluated at compile time, see BSP_GPIO_INIT_TABLE(). If a pin
+ * is listed more than once the last entry wins.
+ *
+ * @param table     The pin table.
+ *
+ * @return  The register values.
+ */
+template <size_t N> 
+constexpr bspGpioBatch_t bspGpioFold(const bspGpioCfg_t (&table)[N])
+{
+    bspGpioBatch_t batch = {};
+
+    for (size_t i = 0; i < N; i++)
+    {
+        const bspGpioCfg_t &cfg = table[i];
+        bspGpioPortCfg_t &port = batch.Port[BSP_IOMAPIDX(cfg.Pin)];
+        uint32_t pins = BSP_IOMAPPIN(cfg.Pin);
+
+        batch.ClkEn |= BSP_IOMAPPEN(cfg.Pin);
+
+        for (uint32_t pos = 0; pos < 16; pos++)
+        {
+            uint32_t pos2 = pos * 2;
+            uint32_t pos4 = (pos % 8) * 4;
+            uint32_t afr = pos / 8;
+
+            if ((pins & (1UL << pos)) == 0)
+                continue;
+
+            port.ModerMsk |= 3UL << pos2;
+            port.Moder = (port.Moder & ~(3UL << pos2)) | (cfg.Mode << pos2);
+
+            port.OtyperMsk |= 1UL << pos;
+            port.Otyper = (port.Otyper & ~(1UL << pos)) | (cfg.OutputType << pos);
+
+            port.OspeedrMsk |= 3UL << pos2;
+            port.Ospeedr = (port.Ospeedr & ~(3UL << pos2)) | (cfg.Speed << pos2);
+
+            port.PupdrMsk |= 3UL << pos2;
+            port.Pupdr = (port.Pupdr & ~(3UL << pos2)) | (cfg.Pull << pos2);
+
+            port.AfrMsk[afr] |= 0xFUL << pos4;
+            port.Afr[afr] = (port.Afr[afr] & ~(0xFUL << pos4)) | (cfg.Alternate << pos4);
+
+            port.Bsrr &= ~((1UL << pos) | (1UL << (pos + 16)));
+            port.Bsrr |= cfg.Level ? 1UL << pos : 1UL << (pos + 16);
+        }
+    }
+
+    return batch;
+}
+
+/**
+ * @brief Used to apply register values derived by bspGpioFold().
+ * 
+ * All needed gpio clocks are enabled at once, afterwards each used port is 
+ * configured by a handful of register writes. The initial levels are set 
+ * before the mode, so outputs do not glitch.
+ *
+ * @param pBatch    The register values.
+ */
+void bspGpioInitBatch(const bspGpioBatch_t *pBatch);
+
+/**
+ * @brief Used to initialize all pins of the given constexpr pin table, which 
+ * is folded into register values at compile time.
+ */
+#define BSP_GPIO_INIT_TABLE(_table)                                         \
+                                                                            \
+    do                                                                      \
+    {                                                                       \
+        static constexpr bspGpioBatch_t _batch = bspGpioFold(_table);       \
+        bspGpioInitBatch(&_batch);                                          \
+    } while (0)
+
 /**
  * @brief Used to initialize gpio pins used by the bsp internally.
  * 
- * E.g. tty, led, buttons, etc.
+ * E.g. tty, led, buttons, etc. Hence that additional board specific pins can
+ * be added to the bsp pin table by defining BSP_GPIO_BOARD_PINS in 
+ * bsp_config.h.
  */
 void bspGpioInit(void);
 
@@ -233,7 +390,10 @@ void bspGpioInit(void);
  * 
  * @param pin   The bsp gpio pin ID.
  */
-void bspGpioSet(bspGpioPin_t pin);
+static inline void bspGpioSet(bspGpioPin_t pin)
+{
+    WRITE_REG(BSP_IOMAPPORT(pin)->BSRR, BSP_IOMAPPIN(pin));
+}
 
 /**
  * @brief Sets the given gpio pin to low.
@@ -243,7 +403,10 @@ void bspGpioSet(bspGpioPin_t pin);
  * 
  * @param pin
  */
-void bspGpioClear(bspGpioPin_t pin);
+static inline void bspGpioClear(bspGpioPin_t pin)
+{
+    WRITE_REG(BSP_IOMAPPORT(pin)->BSRR, BSP_IOMAPPIN(pin) << 16);
+}
 
 /**
  * @brief Toggels the given gpio pins.
@@ -251,9 +414,19 @@ void bspGpioClear(bspGpioPin_t pin);
  * Hence that althow only one pin value can be passed, it is still possible that
  * more than one pin is specified. See BSP_GPIO_x_ALL for a example.
  * 
+ * The new levels are written by a single store to BSRR, so other pins of the
+ * same port changed by a interrupt in the meantime are not affected.
+ * 
  * @param pin   The bsp gpio pin ID.
  */
-void bspGpioToggle(bspGpioPin_t pin);
+static inline void bspGpioToggle(bspGpioPin_t pin)
+{
+    GPIO_TypeDef* port = BSP_IOMAPPORT(pin);
+    uint32_t io_pin = BSP_IOMAPPIN(pin);
+    uint32_t odr = READ_REG(port->ODR);
+
+    WRITE_REG(port->BSRR, ((odr & io_pin) << 16) | (~odr & io_pin));
+}
 
 /**
  * @brief Sets the given gpio pins based on the given value.
@@ -262,7 +435,43 @@ void bspGpioToggle(bspGpioPin_t pin);
  * @param val   If true the pins will be set to high.
  *              If false the pins will become low.
  */
-void bspGpioWrite(bspGpioPin_t pin, uint32_t val);
+static inline void bspGpioWrite(bspGpioPin_t pin, uint32_t val)
+{
+    if(val)
+        bspGpioSet(pin);
+    else
+        bspGpioClear(pin);
+}
+
+/**
+ * @brief Computes the BSRR value which sets the pins given by mask to the
+ * levels given by val, e.g. to precompute waveforms, see bsp_wave.h.
+ *
+ * @param mask  The pins to update, bit n refers to pin n of the port.
+ * @param val   The new levels, bit n refers to pin n of the port.
+ *
+ * @return  The value to write to BSRR.
+ */
+static constexpr inline uint32_t bspGpioBsrrVal(uint16_t mask, uint16_t val)
+{
+    return ((uint32_t)(mask & ~val) << 16) | (uint32_t)(mask & val);
+}
+
+/**
+ * @brief Sets any subset of the pins of a port to individual levels by a 
+ * single store to BSRR.
+ *
+ * @param pin   The bsp gpio pin ID, e.g. BSP_GPIO_A_ALL. Only pins which are 
+ *              part of this ID and of mask are affected.
+ * @param mask  The pins to update, bit n refers to pin n of the port.
+ * @param val   The new levels, bit n refers to pin n of the port.
+ */
+static inline void bspGpioWriteMasked(bspGpioPin_t pin, uint16_t mask, 
+    uint16_t val)
+{
+    WRITE_REG(BSP_IOMAPPORT(pin)->BSRR, 
+        bspGpioBsrrVal(BSP_IOMAPPIN(pin) & mask, val));
+}
 
 /**
  * @brief Used to read the given gpio pins.
@@ -275,6 +484,106 @@ void bspGpioWrite(bspGpioPin_t pin, uint32_t val);
  * @return  true    if the pin is high.
  *          false   if the pin is low.
  */
-bool bspGpioRead(bspGpioPin_t pin);
+static inline bool bspGpioRead(bspGpioPin_t pin)
+{
+    return (READ_REG(BSP_IOMAPPORT(pin)->IDR) & BSP_IOMAPPIN(pin)) ? true : false;
+}
+
+/**
+ * @brief Compile time gpio pin.
+ * 
+ * The port address and the pin mask are derived from the bsp gpio pin ID at
+ * compile time, so all accesses inline to a single load or store. Use this
+ * for hot paths like bit banged protocols, e.g.:
+ * 
+ *      typedef BspPin<BSP_GPIO_A5> Led;
+ *      Led::set();
+ * 
+ * Hence that just like the C functions above more than one pin can be
+ * specified, see BSP_GPIO_x_ALL.
+ */
+template <bspGpioPin_t pin> class BspPin
+{
+    public:
+
+        /**
+         * @brief The address of the gpio port.
+         */
+        static constexpr uint32_t addr(void)
+        {
+            return AHB1PERIPH_BASE + (((uint32_t) pin) >> 16);
+        }
+
+        /**
+         * @brief The bit mask of the pin(s) within the port.
+         */
+        static constexpr uint32_t mask(void)
+        {
+            return BSP_IOMAPPIN(pin);
+        }
+
+        /**
+         * @brief The gpio port.
+         */
+        __attribute__((always_inline)) static inline GPIO_TypeDef *port(void)
+        {
+            return (GPIO_TypeDef *) addr();
+        }
+
+        /**
+         * @brief Sets the pin(s) to high.
+         */
+        __attribute__((always_inline)) static inline void set(void)
+        {
+            WRITE_REG(port()->BSRR, mask());
+        }
+
+        /**
+         * @brief Sets the pin(s) to low.
+         */
+        __attribute__((always_inline)) static inline void clear(void)
+        {
+            WRITE_REG(port()->BSRR, mask() << 16);
+        }
+
+        /**
+         * @brief Sets the pin(s) to the given level.
+         */
+        __attribute__((always_inline)) static inline void write(bool val)
+        {
+            WRITE_REG(port()->BSRR, val ? mask() : mask() << 16);
+        }
+
+        /**
+         * @brief Sets the pins which are part of both, this pin ID and the
+         * given mask, to the levels given by val.
+         */
+        __attribute__((always_inline)) static inline void writeMasked(
+            uint16_t msk, uint16_t val)
+        {
+            WRITE_REG(port()->BSRR, 
+                ((mask() & msk & ~val) << 16) | (mask() & msk & val));
+        }
+
+        /**
+         * @brief Toggles the pin(s) by a single store to BSRR.
+         */
+        __attribute__((always_inline)) static inline void toggle(void)
+        {
+            uint32_t odr = READ_REG(port()->ODR);
+
+            WRITE_REG(port()->BSRR, ((odr & mask()) << 16) | (~odr & mask()));
+        }
+
+        /**
+         * @brief Reads the pin(s).
+         *
+         * @return  true if at least one of the pins is high.
+         */
+        __attribute__((always_inline)) static inline bool read(void)
+        {
+            return (READ_REG(port()->IDR) & mask()) != 0;
+        }
+};
 
 #endif /* BSP_NUCLEO_F446_GPIO_H_ */
@@ -0,0 +1,121 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+#ifndef BSP_NUCLEO_F446_ICAP_H_
+#define BSP_NUCLEO_F446_ICAP_H_
+
+#include "bsp/bsp.h"
+
+#include <stdint.h>
+
+/**
+ * Input capture frequency and duty cycle meter.
+ * 
+ * The signal on BSP_GPIO_ICAP (PA0) is connected to channel 1 and 2 of the 
+ * free running 32 bit timer TIM5. Channel 1 captures the rising and channel 
+ * 2 the falling edges, both are copied to circular buffers by DMA1 Stream2 
+ * and Stream4 (Channel6). So there is no interrupt per edge, the results 
+ * are computed on demand from the latest captures by bspIcapMeasure().
+ * 
+ * Hence that TIM2, the other 32 bit timer, can not be used as its channel 2 
+ * shares DMA1 Stream6 with the tty.
+ */
+
+#if BSP_ICAP == BSP_ENABLED
+
+/**
+ * @brief The DMA requests used, TIM5_CH1 on DMA1 Stream2 and TIM5_CH2 on 
+ * DMA1 Stream4, both Channel6.
+ */
+#define BSP_ICAP_RISE_REQ                   BSP_DMA_REQ_TIM5_CH1
+#define BSP_ICAP_FALL_REQ                   BSP_DMA_REQ_TIM5_CH2
+
+#ifndef BSP_ICAP_SIZE
+
+/**
+ * @brief Number of captures per edge kept in the buffers.
+ */
+#define BSP_ICAP_SIZE                       32
+
+#endif
+
+#ifndef BSP_ICAP_FILTER
+
+/**
+ * @brief The input filter, LL_TIM_IC_FILTER_x.
+ */
+#define BSP_ICAP_FILTER                     LL_TIM_IC_FILTER_FDIV1
+
+#endif
+
+/**
+ * @brief The result of a measurement.
+ */
+typedef struct
+{
+    uint32_t Periods;               ///<! Number of periods used
+    uint32_t Ticks;                 ///<! Sum of all periods in timer ticks
+    uint32_t HighTicks;             ///<! Sum of all high times in ticks
+    uint32_t Clock;                 ///<! The timer clock in Hz
+    uint32_t FreqHz;                ///<! The frequency in Hz
+    uint32_t FreqMilliHz;           ///<! The frequency in mHz, saturates
+    uint32_t DutyPermille;          ///<! The duty cycle in 1/1000
+
+} bspIcapResult_t;
+
+/**
+ * @brief Used to initialize the meter, called by bspChipInit().
+ */
+void bspIcapInit(void);
+
+/**
+ * @brief Used to start capturing.
+ */
+void bspIcapStart(void);
+
+/**
+ * @brief Used to stop capturing.
+ */
+void bspIcapStop(void);
+
+/**
+ * @brief Used to compute the mean period, frequency and duty cycle of the 
+ * latest periods. 
+ * 
+ * Hence that the sum of the periods must not exceed 2^32 timer ticks. n is
+ * limited to half of the buffers, so the DMA can write the other half while
+ * the captures are evaluated.
+ *
+ * @param n         The number of periods to use, 1 to BSP_ICAP_SIZE / 2.
+ * @param pRes      Where to store the result.
+ *
+ * @return  BSP_OK on success.
+ *          BSP_EEINVAL if n is out of range.
+ *          BSP_EEMPTY if less than n periods have been captured so far.
+ *          BSP_ETIMEOUT if there was no edge for more than two periods, 
+ *          e.g. if the signal has stopped.
+ */
+bspStatus_t bspIcapMeasure(uint32_t n, bspIcapResult_t *pRes);
+
+#endif /* BSP_ICAP == BSP_ENABLED */
+
+#endif /* BSP_NUCLEO_F446_ICAP_H_ */
@@ -0,0 +1,264 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+#ifndef BSP_NUCLEO_F446_ISR_H_
+#define BSP_NUCLEO_F446_ISR_H_
+
+#include "bsp/bsp.h"
+#include "bsp/bsp_trace.h"
+
+#include <stdint.h>
+
+/**
+ * @brief IDs of all interrupt service routines implemented by the bsp.
+ */
+typedef enum
+{
+    BSP_ISR_SYSTICK = 0,            ///<! SysTick_Handler
+    BSP_ISR_TTY_USART,              ///<! TTY_USARTx_IRQHandler (USART2)
+    BSP_ISR_TTY_TXDMA,              ///<! TTY_TXDMA_REQ (DMA1 S6)
+    BSP_ISR_EXTI0,                  ///<! EXTI0_IRQHandler
+    BSP_ISR_EXTI1,                  ///<! EXTI1_IRQHandler
+    BSP_ISR_EXTI2,                  ///<! EXTI2_IRQHandler
+    BSP_ISR_EXTI3,                  ///<! EXTI3_IRQHandler
+    BSP_ISR_EXTI4,                  ///<! EXTI4_IRQHandler
+    BSP_ISR_EXTI9_5,                ///<! EXTI9_5_IRQHandler
+    BSP_ISR_EXTI15_10,              ///<! EXTI15_10_IRQHandler
+    BSP_ISR_PROF,                   ///<! TIM7_IRQHandler, see bsp_prof.h
+    BSP_ISR_WAVE,                   ///<! DMA2_Stream1_IRQHandler, bsp_wave.h
+    BSP_ISR_CAPTURE,                ///<! DMA2_Stream5_IRQHandler, bsp_capture.h
+    BSP_ISR_ICAP,                   ///<! DMA1_Stream2_IRQHandler, bsp_icap.h
+    BSP_ISR_DMA_M2M,                ///<! BSP_DMA_M2M_REQ, bsp_dma.h
+    BSP_ISR_WORK,                   ///<! PendSV_Handler, bsp_work.h
+    BSP_ISR_SCHED1,                 ///<! CEC_IRQHandler, bsp_sched.h
+    BSP_ISR_SCHED2,                 ///<! SPDIF_RX_IRQHandler, bsp_sched.h
+    BSP_ISR_SCHED3,                 ///<! QUADSPI_IRQHandler, bsp_sched.h
+    BSP_ISR_CNT
+
+} bspIsrId_t;
+
+#if BSP_ISR_STATS == BSP_ENABLED
+
+#ifndef BSP_ISR_STATS_BUCKETS
+
+/**
+ * @brief Number of log2 buckets per histogram. Bucket n counts all values in
+ * the range [2^n, 2^(n+1)), bucket 0 also counts 0 and the last bucket 
+ * counts all values >= 2^(BSP_ISR_STATS_BUCKETS - 1), as labeled in the dump.
+ */
+#define BSP_ISR_STATS_BUCKETS               16
+
+#endif
+
+/**
+ * @brief A log2 histogram of cycle counts.
+ *
+ * Hence that the sum and the number of samples are 64 bit wide and the
+ * buckets saturate, so nothing will overflow during long soak runs.
+ */
+typedef struct
+{
+    uint32_t Min;
+    uint32_t Max;
+    uint64_t Sum;
+    uint64_t Cnt;
+    uint32_t Bucket[BSP_ISR_STATS_BUCKETS];
+
+} bspIsrHist_t;
+
+/**
+ * @brief Statistics recorded for a single interrupt service routine.
+ */
+typedef struct
+{
+    bspIsrHist_t Exec;              ///<! Cycles from entry to exit
+    bspIsrHist_t Latency;           ///<! Cycles from the event to the entry
+
+} bspIsrStat_t;
+
+/**
+ * @brief Used by BSP_ISR_EXIT() to record the execution time of a isr.
+ *
+ * @param id        The isr ID.
+ * @param cycles    The execution time in cycles.
+ */
+void bspIsrStatExec(bspIsrId_t id, uint32_t cycles);
+
+/**
+ * @brief Used by BSP_ISR_LATENCY() to record the entry latency of a isr.
+ *
+ * @param id        The isr ID.
+ * @param cycles    The number of cycles between the event and the entry.
+ */
+void bspIsrStatLatency(bspIsrId_t id, uint32_t cycles);
+
+/**
+ * @brief Used to get a consistent copy of the statistics of a isr.
+ *
+ * @param id        The isr ID.
+ * @param pStat     Where to copy the data to.
+ */
+void bspIsrStatGet(bspIsrId_t id, bspIsrStat_t *pStat);
+
+/**
+ * @brief Used to reset the statistics of all isr's.
+ */
+void bspIsrStatReset(void);
+
+/**
+ * @brief Used to print the statistics of all isr's to stdout.
+ */
+void bspIsrStatDump(void);
+
+/**
+ * @brief Used by BSP_ISR_ENTER() to take the start time.
+ */
+#define BSP_ISR_STAT_ENTER(_id)                                             \
+                                                                            \
+    uint32_t _isrStart = bspGetCycleCount()
+
+/**
+ * @brief Used by BSP_ISR_EXIT() to record the execution time.
+ */
+#define BSP_ISR_STAT_EXIT(_id)                                              \
+                                                                            \
+    bspIsrStatExec(_id, bspGetCycleCount() - _isrStart)
+
+/**
+ * @brief Used to record the entry latency of a isr, if the hardware allows
+ * to measure it.
+ */
+#define BSP_ISR_LATENCY(_id, _cycles)                                       \
+                                                                            \
+    bspIsrStatLatency(_id, _cycles)
+
+#else /* BSP_ISR_STATS == BSP_ENABLED */
+
+/**
+ * @brief Empty declaration as isr statistics are disabled.
+ */
+#define BSP_ISR_STAT_ENTER(_id)
+
+/**
+ * @brief Empty declaration as isr statistics are disabled.
+ */
+#define BSP_ISR_STAT_EXIT(_id)
+
+/**
+ * @brief Empty declaration as isr statistics are disabled.
+ */
+#define BSP_ISR_LATENCY(_id, _cycles)
+
+#endif /* BSP_ISR_STATS == BSP_ENABLED */
+
+#if BSP_TRACE == BSP_ENABLED
+
+/**
+ * @brief The trace channels used to signal the execution of the isr's, use
+ * -1 to not trace a isr. Channel 3 is left for the application by default.
+ * 
+ * Hence that isr's sharing a channel will clear it on exit, even if they
+ * have preempted each other.
+ */
+#ifndef BSP_TRACE_ISR_SYSTICK
+#define BSP_TRACE_ISR_SYSTICK               0
+#endif
+
+#ifndef BSP_TRACE_ISR_TTY
+#define BSP_TRACE_ISR_TTY                   1
+#endif
+
+#ifndef BSP_TRACE_ISR_EXTI
+#define BSP_TRACE_ISR_EXTI                  2
+#endif
+
+/**
+ * @brief Maps the isr ID's to trace channels at compile time.
+ */
+static constexpr int bspIsrTraceCh(bspIsrId_t id)
+{
+    return id == BSP_ISR_SYSTICK    ? BSP_TRACE_ISR_SYSTICK :
+           id == BSP_ISR_TTY_USART  ? BSP_TRACE_ISR_TTY :
+           id == BSP_ISR_TTY_TXDMA  ? BSP_TRACE_ISR_TTY :
+           id == BSP_ISR_EXTI0      ? BSP_TRACE_ISR_EXTI :
+           id == BSP_ISR_EXTI1      ? BSP_TRACE_ISR_EXTI :
+           id == BSP_ISR_EXTI2      ? BSP_TRACE_ISR_EXTI :
+           id == BSP_ISR_EXTI3      ? BSP_TRACE_ISR_EXTI :
+           id == BSP_ISR_EXTI4      ? BSP_TRACE_ISR_EXTI :
+           id == BSP_ISR_EXTI9_5    ? BSP_TRACE_ISR_EXTI :
+           id == BSP_ISR_EXTI15_10  ? BSP_TRACE_ISR_EXTI :
+           -1;
+}
+
+/**
+ * @brief Used by BSP_ISR_ENTER() to set the trace channel of the isr.
+ */
+#define BSP_ISR_TRACE_ENTER(_id)                                            \
+                                                                            \
+    do                                                                      \
+    {                                                                       \
+        if (bspIsrTraceCh(_id) >= 0)                                        \
+            bspTraceHigh(bspIsrTraceCh(_id));                               \
+    } while (0)
+
+/**
+ * @brief Used by BSP_ISR_EXIT() to clear the trace channel of the isr.
+ */
+#define BSP_ISR_TRACE_EXIT(_id)                                             \
+                                                                            \
+    do                                                                      \
+    {                                                                       \
+        if (bspIsrTraceCh(_id) >= 0)                                        \
+            bspTraceLow(bspIsrTraceCh(_id));                                \
+    } while (0)
+
+#else /* BSP_TRACE == BSP_ENABLED */
+
+/**
+ * @brief Empty declaration as tracing is disabled.
+ */
+#define BSP_ISR_TRACE_ENTER(_id)
+
+/**
+ * @brief Empty declaration as tracing is disabled.
+ */
+#define BSP_ISR_TRACE_EXIT(_id)
+
+#endif /* BSP_TRACE == BSP_ENABLED */
+
+/**
+ * @brief Has to be placed at the very beginning of every bsp isr.
+ */
+#define BSP_ISR_ENTER(_id)                                                  \
+                                                                            \
+    BSP_ISR_TRACE_ENTER(_id);                                               \
+    BSP_ISR_STAT_ENTER(_id)
+
+/**
+ * @brief Has to be placed at the very end of every bsp isr.
+ */
+#define BSP_ISR_EXIT(_id)                                                   \
+                                                                            \
+    BSP_ISR_STAT_EXIT(_id);                                                 \
+    BSP_ISR_TRACE_EXIT(_id)
+
+#endif /* BSP_NUCLEO_F446_ISR_H_ */
@@ -0,0 +1,128 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+#ifndef BSP_NUCLEO_F446_PROF_H_
+#define BSP_NUCLEO_F446_PROF_H_
+
+#include "bsp/bsp.h"
+
+#include <stdint.h>
+
+/**
+ * Statistical pc sampling profiler.
+ *
+ * The stacked pc of the interrupted context is sampled either in the sys tick
+ * interrupt or, if BSP_PROF_TIMER is enabled, in the TIM7 interrupt at
+ * BSP_PROF_RATE_HZ. bspProfDump() prints the samples as text which can be
+ * turned into a flat profile by tools/bsp_prof.py using the elf file.
+ */
+
+/**
+ * @brief Samples are counted per pc in a hash table.
+ */
+#define BSP_PROF_MODE_HASH                  0
+
+/**
+ * @brief Raw samples are written to a ring buffer which is drained by
+ * bspProfDump(), use this for streaming.
+ */
+#define BSP_PROF_MODE_RING                  1
+
+#if BSP_PROF == BSP_ENABLED
+
+#ifndef BSP_PROF_MODE
+#define BSP_PROF_MODE                       BSP_PROF_MODE_HASH
+#endif
+
+#ifndef BSP_PROF_SIZE
+
+/**
+ * @brief Number of hash table entries or ring buffer samples, has to be a
+ * power of two.
+ */
+#define BSP_PROF_SIZE                       256
+
+#endif
+
+#ifndef BSP_PROF_RATE_HZ
+
+/**
+ * @brief Sample rate if BSP_PROF_TIMER is enabled.
+ */
+#define BSP_PROF_RATE_HZ                    10000
+
+#endif
+
+/**
+ * @brief True if the sys tick interrupt is used as sample source.
+ */
+#define BSP_PROF_SYSTICK                    (BSP_PROF_TIMER != BSP_ENABLED)
+
+#if BSP_PROF_SYSTICK && BSP_SYSTICK != BSP_ENABLED
+#error The profiler needs BSP_SYSTICK or BSP_PROF_TIMER
+#endif
+
+/**
+ * @brief Used to initialize the profiler, called by bspChipInit().
+ */
+void bspProfInit(void);
+
+/**
+ * @brief Used to start sampling.
+ */
+void bspProfStart(void);
+
+/**
+ * @brief Used to stop sampling.
+ */
+void bspProfStop(void);
+
+/**
+ * @brief Used to drop all samples taken so far.
+ */
+void bspProfReset(void);
+
+/**
+ * @brief Used to take a sample, called by the sample interrupt.
+ *
+ * @param pFrame    The exception frame of the interrupted context.
+ */
+void bspProfSample(bspExcFrame_t *pFrame);
+
+/**
+ * @brief Used to print the samples to stdout.
+ *
+ * In hash mode all entries will be printed, in ring mode all samples
+ * taken since the last call will be printed and removed from the ring.
+ */
+void bspProfDump(void);
+
+#else /* BSP_PROF == BSP_ENABLED */
+
+/**
+ * @brief The profiler is disabled.
+ */
+#define BSP_PROF_SYSTICK                    0
+
+#endif /* BSP_PROF == BSP_ENABLED */
+
+#endif /* BSP_NUCLEO_F446_PROF_H_ */
@@ -0,0 +1,107 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+
+#ifndef BSP_NUCLEO_F446_RTOS_H_
+#define BSP_NUCLEO_F446_RTOS_H_
+
+#include "bsp/bsp.h"
+
+/**
+ * FreeRTOS integration.
+ * 
+ * If BSP_RTOS is enabled the bsp stays usable before the scheduler has been
+ * started and from interrupts, but blocks on RTOS objects instead of busy 
+ * waiting when called from a task:
+ * 
+ * - _write (and therefore printf) holds a mutex for the whole call, so the
+ *   output of concurrent tasks does not interleave. If the fifo is full it 
+ *   waits for a semaphore given by the tx DMA interrupt.
+ * - bspTTYGetChar() waits for a task notification from the receive 
+ *   interrupt. Hence that only one task may read at a time and that the 
+ *   notification value of the reading task is used.
+ * - bspDelayMs() uses vTaskDelay().
+ * 
+ * The sys tick handler stays with the bsp and forwards each tick to 
+ * xPortSysTickHandler() once the scheduler has been started, so the 
+ * mapping of xPortSysTickHandler to SysTick_Handler has to be removed from
+ * FreeRTOSConfig.h and configTICK_RATE_HZ has to be 1000. Hence that the
+ * port reprograms the sys tick when the scheduler is started, so 
+ * configCPU_CLOCK_HZ has to be SystemCoreClock. The port also moves the sys
+ * tick to configKERNEL_INTERRUPT_PRIORITY, the first forwarded tick restores
+ * BSP_IRQPRIO_SYSTICK. As the port handler clears BASEPRI on exit, the bsp
+ * restores the BASEPRI it has been called with.
+ */
+
+#if BSP_RTOS == BSP_ENABLED
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <semphr.h>
+
+#if BSP_SYSTICK != BSP_ENABLED
+#error BSP_RTOS needs BSP_SYSTICK
+#endif
+
+#if BSP_TTY_RX_IRQ != BSP_ENABLED
+#error BSP_RTOS needs BSP_TTY_RX_IRQ
+#endif
+
+#if BSP_WORK == BSP_ENABLED && BSP_WORK_PENDSV == BSP_ENABLED
+#error PendSV is used by FreeRTOS, disable BSP_WORK_PENDSV
+#endif
+
+#if BSP_SCHED == BSP_ENABLED
+#error BSP_SCHED can not be used together with BSP_RTOS
+#endif
+
+#ifdef xPortSysTickHandler
+#error The sys tick handler is implemented by the bsp, remove the mapping of xPortSysTickHandler from FreeRTOSConfig.h
+#endif
+
+static_assert(configTICK_RATE_HZ == 1000, 
+    "The sys tick is shared with the bsp, configTICK_RATE_HZ has to be 1000");
+
+static_assert(configMAX_SYSCALL_INTERRUPT_PRIORITY == 
+    (BSP_IRQPRIO_FREERTOS_SYSCALL << (8 - __NVIC_PRIO_BITS)),
+    "configMAX_SYSCALL_INTERRUPT_PRIORITY does not match "
+    "BSP_IRQPRIO_FREERTOS_SYSCALL");
+
+/**
+ * @brief The sys tick handler of the FreeRTOS port.
+ */
+extern "C" void xPortSysTickHandler(void);
+
+/**
+ * @brief Used to check if the caller may block on RTOS objects.
+ * 
+ * @return  true if the scheduler is running and the caller is a task.
+ */
+static inline bool bspRtosCanBlock(void)
+{
+    return __get_IPSR() == 0 && 
+        xTaskGetSchedulerState() == taskSCHEDULER_RUNNING;
+}
+
+#endif /* BSP_RTOS == BSP_ENABLED */
+
+#endif /* BSP_NUCLEO_F446_RTOS_H_ */
@@ -0,0 +1,174 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+
+#ifndef BSP_NUCLEO_F446_SCHED_H_
+#define BSP_NUCLEO_F446_SCHED_H_
+
+#include "bsp/bsp.h"
+#include "bsp/bsp_exti.h"
+#include "bsp/bsp_gpio.h"
+
+#include <stdint.h>
+
+/**
+ * Event driven run to completion scheduler.
+ * 
+ * Tasks are functions which are called with the events they have been 
+ * signaled since their last run and return once done, so all tasks share a
+ * single stack. Each task is assigned to a level, within a level the task 
+ * with the lowest ID runs first.
+ * 
+ * Level 0 is run by bspSchedRun() in the main loop, which sleeps with WFI 
+ * as long as nothing is ready. Levels 1 and above are run by software 
+ * triggered interrupts at BSP_IRQPRIO_SCHED and below, a higher level 
+ * preempts all lower levels. They use the vectors of CEC, SPDIF-RX and 
+ * QUADSPI which are not available to the application in this case.
+ * 
+ * Tasks can be signaled by any context, by a per task timer driven by the 
+ * sys tick, by the tty receive interrupt and by EXTI lines. Hence that the
+ * PendSV exception is left to BSP_WORK_PENDSV.
+ */
+
+#if BSP_SCHED == BSP_ENABLED
+
+#if BSP_SYSTICK != BSP_ENABLED
+#error The scheduler needs BSP_SYSTICK
+#endif
+
+#ifndef BSP_SCHED_TASKS
+
+/**
+ * @brief Number of tasks, 1 to 32.
+ */
+#define BSP_SCHED_TASKS                     8
+
+#endif
+
+#ifndef BSP_SCHED_LEVELS
+
+/**
+ * @brief Number of levels including the main loop level 0, 1 to 4.
+ */
+#define BSP_SCHED_LEVELS                    3
+
+#endif
+
+/**
+ * @brief Events signaled by the bsp, the remaining bits are free for the 
+ * application.
+ */
+#define BSP_SCHED_EV_TIMER                  (1UL << 31)
+#define BSP_SCHED_EV_TTY                    (1UL << 30)
+#define BSP_SCHED_EV_EXTI                   (1UL << 29)
+
+/**
+ * @brief A task function.
+ * 
+ * @param pCtx      The context given to bspSchedAdd().
+ * @param events    The events signaled since the last run, never 0.
+ */
+typedef void (*bspSchedFn_t)(void *pCtx, uint32_t events);
+
+/**
+ * @brief Used to initialize the scheduler, called by bspChipInit().
+ */
+void bspSchedInit(void);
+
+/**
+ * @brief Used to add a task.
+ *
+ * @param task      The ID of the task, 0 to BSP_SCHED_TASKS - 1.
+ * @param level     The level, 0 to BSP_SCHED_LEVELS - 1.
+ * @param fn        The task function.
+ * @param pCtx      Passed to the task function.
+ *
+ * @return  BSP_OK on success.
+ *          BSP_EBUSY if the task ID is already used.
+ *          BSP_EEINVAL in case of invalid arguments.
+ */
+bspStatus_t bspSchedAdd(uint32_t task, uint32_t level, bspSchedFn_t fn, 
+    void *pCtx);
+
+/**
+ * @brief Used to signal events to a task, can be called from any context.
+ *
+ * @param task      The ID of the task.
+ * @param events    The events, or'ed to the pending ones.
+ */
+void bspSchedSignal(uint32_t task, uint32_t events);
+
+/**
+ * @brief Used to signal BSP_SCHED_EV_TIMER to a task after a delay.
+ *
+ * @param task      The ID of the task.
+ * @param delay     The delay in ms, 0 stops the timer.
+ * @param period    The period in ms after the first expiry, 0 for a one 
+ *                  shot timer.
+ *
+ * @return  BSP_OK on success.
+ *          BSP_EEINVAL in case of invalid arguments.
+ */
+bspStatus_t bspSchedSetTimer(uint32_t task, uint32_t delay, uint32_t period);
+
+#if BSP_TTY_RX_IRQ == BSP_ENABLED
+
+/**
+ * @brief Used to signal BSP_SCHED_EV_TTY to a task for each received 
+ * character.
+ *
+ * @param task      The ID of the task.
+ *
+ * @return  BSP_OK on success.
+ *          BSP_EEINVAL in case of invalid arguments.
+ */
+bspStatus_t bspSchedOnTTY(uint32_t task);
+
+#endif /* BSP_TTY_RX_IRQ == BSP_ENABLED */
+
+/**
+ * @brief Used to signal BSP_SCHED_EV_EXTI to a task on edges of a pin, see
+ * bspExtiAttach().
+ *
+ * @param task      The ID of the task.
+ * @param pin       The bsp gpio pin ID, has to refer to a single pin.
+ * @param edge      The edge(s) to trigger on.
+ *
+ * @return  See bspExtiAttach().
+ */
+bspStatus_t bspSchedOnExti(uint32_t task, bspGpioPin_t pin, 
+    bspExtiEdge_t edge);
+
+/**
+ * @brief Used to run the timers, called by the sys tick interrupt.
+ */
+void bspSchedTick(void);
+
+/**
+ * @brief Used to run level 0 forever, the core sleeps while no task is 
+ * ready.
+ */
+void bspSchedRun(void) __attribute__((noreturn));
+
+#endif /* BSP_SCHED == BSP_ENABLED */
+
+#endif /* BSP_NUCLEO_F446_SCHED_H_ */
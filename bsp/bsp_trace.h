@@ -0,0 +1,141 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+#ifndef BSP_NUCLEO_F446_TRACE_H_
+#define BSP_NUCLEO_F446_TRACE_H_
+
+#include "bsp/bsp.h"
+#include "bsp/bsp_gpio.h"
+
+/**
+ * Trace channels 0..3 are mapped to BSP_DEBUGPIN_0..3 as defined in
+ * bsp_config.h, which are initialized by bspGpioInit(). All macros below boil
+ * down to single stores to the BSRR register of the pin's port, if BSP_TRACE
+ * is disabled they vanish.
+ *
+ * ATTENTION: On the nucleo board PC14 and PC15 (BSP_DEBUGPIN_0/1 by default)
+ * are supplied by the backup domain switch and are limited to 2MHz. Use
+ * BSP_DEBUGPIN_2/3 for events faster than that.
+ */
+#if BSP_TRACE == BSP_ENABLED
+
+/**
+ * @brief Maps the trace channels to the debug pins.
+ */
+static constexpr bspGpioPin_t bspTracePins[] =
+{
+    BSP_DEBUGPIN_0, BSP_DEBUGPIN_1, BSP_DEBUGPIN_2, BSP_DEBUGPIN_3
+};
+
+/**
+ * @brief Sets the pin of the given trace channel to high.
+ */
+__attribute__((always_inline)) static inline void bspTraceHigh(uint32_t ch)
+{
+    WRITE_REG(BSP_IOMAPPORT(bspTracePins[ch])->BSRR,
+        BSP_IOMAPPIN(bspTracePins[ch]));
+}
+
+/**
+ * @brief Sets the pin of the given trace channel to low.
+ */
+__attribute__((always_inline)) static inline void bspTraceLow(uint32_t ch)
+{
+    WRITE_REG(BSP_IOMAPPORT(bspTracePins[ch])->BSRR,
+        BSP_IOMAPPIN(bspTracePins[ch]) << 16);
+}
+
+/**
+ * @brief Keeps the pin of the given trace channel high as long as the object
+ * lives.
+ */
+class BspTraceScope
+{
+    public:
+
+        __attribute__((always_inline)) BspTraceScope(uint32_t ch) : Ch(ch)
+        {
+            bspTraceHigh(Ch);
+        }
+
+        __attribute__((always_inline)) ~BspTraceScope()
+        {
+            bspTraceLow(Ch);
+        }
+
+    private:
+
+        const uint32_t Ch;
+};
+
+/**
+ * @brief Sets the given trace channel to high.
+ */
+#define BSP_TRACE_HIGH(_ch)                 bspTraceHigh(_ch)
+
+/**
+ * @brief Sets the given trace channel to low.
+ */
+#define BSP_TRACE_LOW(_ch)                  bspTraceLow(_ch)
+
+/**
+ * @brief Emits a short pulse on the given trace channel.
+ */
+#define BSP_TRACE_MARK(_ch)                                                 \
+                                                                            \
+    do                                                                      \
+    {                                                                       \
+        bspTraceHigh(_ch);                                                  \
+        bspTraceLow(_ch);                                                   \
+    } while (0)
+
+/**
+ * @brief Keeps the given trace channel high until the end of the current
+ * scope.
+ */
+#define BSP_TRACE_SCOPE(_ch)                BspTraceScope _traceScope(_ch)
+
+#else /* BSP_TRACE == BSP_ENABLED */
+
+/**
+ * @brief Empty declaration as tracing is disabled.
+ */
+#define BSP_TRACE_HIGH(_ch)
+
+/**
+ * @brief Empty declaration as tracing is disabled.
+ */
+#define BSP_TRACE_LOW(_ch)
+
+/**
+ * @brief Empty declaration as tracing is disabled.
+ */
+#define BSP_TRACE_MARK(_ch)
+
+/**
+ * @brief Empty declaration as tracing is disabled.
+ */
+#define BSP_TRACE_SCOPE(_ch)
+
+#endif /* BSP_TRACE == BSP_ENABLED */
+
+#endif /* BSP_NUCLEO_F446_TRACE_H_ */
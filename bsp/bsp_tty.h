@@ -50,6 +50,20 @@ bspStatus_t bspTTYSendData(uint8_t *pData, uint16_t siz);
  */
 bool bspTTYDataAvailable(void);
 
+/**
+ * @brief Used to wait until all pending data has been sent.
+ * 
+ * Hence that this function will block and must not be called from an 
+ * interrupt if BSP_TTY_TX_DMA is enabled.
+ */
+void bspTTYFlush(void);
+
+/**
+ * @brief Used to recompute the baud rate register after the APB1 clock has
+ * been changed, called by bspClockApply().
+ */
+void bspTTYClockUpdate(void);
+
 /**
  * @brief Used to read a single character from the TTY.
  * 
@@ -59,6 +73,26 @@ bool bspTTYDataAvailable(void);
  */
 char bspTTYGetChar(void);
 
+#if BSP_TTY_RX_IRQ == BSP_ENABLED
+
+/**
+ * @brief Called from the receive interrupt.
+ * 
+ * @param pCtx      The context passed to bspTTYSetRxNotify().
+ */
+typedef void (*bspTTYNotify_t)(void *pCtx);
+
+/**
+ * @brief Used to get notified for each received character, e.g. to wake up
+ * a task instead of polling bspTTYDataAvailable().
+ *
+ * @param cb        The callback, NULL to disable.
+ * @param pCtx      Passed to the callback.
+ */
+void bspTTYSetRxNotify(bspTTYNotify_t cb, void *pCtx);
+
+#endif /* BSP_TTY_RX_IRQ == BSP_ENABLED */
+
 #if BSP_ASSERT_MESSAGE == BSP_ENABLED
 
 /**
@@ -67,6 +101,9 @@ char bspTTYGetChar(void);
  * This function can be assumed to prevent the tty from working as usual. The 
  * root cause for that behaviour is that this function as to work in any 
  * possible context, also in every interrupt.
+ * 
+ * Hence that nothing is printed before bspTTYInit() and that the message is
+ * dropped if the tty does not accept a character in time.
  */
 void bspTTYAssertMessage(char *pChar);
 
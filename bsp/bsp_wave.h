@@ -0,0 +1,132 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+#ifndef BSP_NUCLEO_F446_WAVE_H_
+#define BSP_NUCLEO_F446_WAVE_H_
+
+#include "bsp/bsp.h"
+#include "bsp/bsp_gpio.h"
+
+#include <stdint.h>
+
+/**
+ * DMA waveform engine.
+ *
+ * Streams a buffer of precomputed BSRR words into the BSRR register of a
+ * gpio port, one word per update event of TIM8. The transfers are done by
+ * DMA2 Stream1 Channel7 (TIM8_UP) without any cpu involvement, so the output
+ * timing only depends on the timer. Use bspGpioBsrrVal() to compute the 
+ * words, each of them can set and clear any subset of the pins of the port.
+ * 
+ * Hence that the pins to drive have to be configured as outputs, e.g. by 
+ * BSP_GPIO_BOARD_PINS, and that the rate is limited by the bus matrix to a 
+ * few MHz depending on the other bus masters. 
+ */
+
+#if BSP_WAVE == BSP_ENABLED
+
+/**
+ * @brief The DMA request used, TIM8_UP on DMA2 Stream1 Channel7.
+ */
+#define BSP_WAVE_DMA_REQ                    BSP_DMA_REQ_TIM8_UP
+
+/**
+ * @brief Supported transfer modes.
+ */
+typedef enum
+{
+    BSP_WAVE_ONESHOT = 0,           ///<! Buffer 0 once, callback when done
+    BSP_WAVE_CIRCULAR,              ///<! Buffer 0 endless, callback per half
+    BSP_WAVE_DOUBLEBUF              ///<! Buffer 0 and 1 alternating
+
+} bspWaveMode_t;
+
+/**
+ * @brief Called from the dma interrupt.
+ * 
+ * In one shot mode the buffer has been sent completely. In circular mode the
+ * given half of the buffer, in double buffer mode the given buffer, has been 
+ * sent and can be refilled while the other one is being sent.
+ * 
+ * @param pBuf      The part of the buffer which is free now.
+ * @param len       Its number of words.
+ * @param pCtx      The context pointer passed to bspWaveStart().
+ */
+typedef void (*bspWaveCb_t)(uint32_t *pBuf, uint16_t len, void *pCtx);
+
+/**
+ * @brief Configuration of a waveform.
+ */
+typedef struct
+{
+    bspGpioPin_t Port;              ///<! Any pin ID of the port to drive
+    bspWaveMode_t Mode;             ///<! The transfer mode
+    uint32_t RateHz;                ///<! Words per second
+    uint32_t *pBuf[2];              ///<! pBuf[1] is used in double buf mode
+    uint16_t Len;                   ///<! Words per buffer
+    bspWaveCb_t Cb;                 ///<! Optional, may be NULL
+    void *pCtx;                     ///<! Passed to Cb
+
+} bspWaveCfg_t;
+
+/**
+ * @brief Used to initialize the waveform engine, called by bspChipInit().
+ */
+void bspWaveInit(void);
+
+/**
+ * @brief Used to start a waveform.
+ * 
+ * The real rate is the timer clock divided by a integer, so it might differ
+ * slightly from the requested one. See bspWaveGetRate().
+ *
+ * @param pCfg      The configuration, can be discarded afterwards but not 
+ *                  the buffers.
+ * 
+ * @return  BSP_OK on success.
+ *          BSP_EBUSY if a waveform is still running.
+ *          BSP_EEINVAL in case of invalid arguments.
+ */
+bspStatus_t bspWaveStart(const bspWaveCfg_t *pCfg);
+
+/**
+ * @brief Used to stop the waveform immediately. 
+ * 
+ * Hence that the pins keep the last written level.
+ */
+void bspWaveStop(void);
+
+/**
+ * @brief Used to check if a waveform is running.
+ */
+bool bspWaveIsBusy(void);
+
+/**
+ * @brief Used to get the real rate of the current waveform.
+ *
+ * @return  The rate in Hz.
+ */
+uint32_t bspWaveGetRate(void);
+
+#endif /* BSP_WAVE == BSP_ENABLED */
+
+#endif /* BSP_NUCLEO_F446_WAVE_H_ */
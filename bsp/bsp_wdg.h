@@ -0,0 +1,138 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+
+#ifndef BSP_NUCLEO_F446_WDG_H_
+#define BSP_NUCLEO_F446_WDG_H_
+
+#include "bsp/bsp.h"
+
+#include <stdint.h>
+
+/**
+ * Watchdog service.
+ *
+ * The independent watchdog is started by bspChipInit() and fed by the sys
+ * tick interrupt as long as all registered clients are healthy. A client is
+ * healthy if it has called bspWdgCheckIn() within its own timeout since the
+ * last check in. Once a client misses its deadline the watchdog is not fed
+ * any more and resets the cpu after BSP_WDG_TIMEOUT_MS. The client is kept
+ * in the RTC backup register BSP_WDG_BKP_REG and can be read by
+ * bspWdgGetMissed() after the reset. It is also recorded in the crash record
+ * if BSP_CRASH is enabled and in the event log if BSP_EVLOG is enabled.
+ *
+ * Hence that the watchdog also resets the cpu if the sys tick interrupt is
+ * blocked for longer than BSP_WDG_TIMEOUT_MS. It is stopped while the core
+ * is halted by a debugger.
+ */
+
+#if BSP_WDG == BSP_ENABLED
+
+#if BSP_SYSTICK != BSP_ENABLED
+#error The watchdog service needs BSP_SYSTICK
+#endif
+
+#ifndef BSP_WDG_TIMEOUT_MS
+
+/**
+ * @brief Timeout of the watchdog in ms, up to 32000.
+ */
+#define BSP_WDG_TIMEOUT_MS                  500
+
+#endif
+
+#ifndef BSP_WDG_CLIENTS
+
+/**
+ * @brief Number of clients, 1 to 32.
+ */
+#define BSP_WDG_CLIENTS                     8
+
+#endif
+
+#ifndef BSP_WDG_BKP_REG
+
+/**
+ * @brief The RTC backup register used to keep the missed client, 0 to 19.
+ */
+#define BSP_WDG_BKP_REG                     19
+
+#endif
+
+/**
+ * @brief Used to start the watchdog, called by bspChipInit().
+ */
+void bspWdgInit(void);
+
+/**
+ * @brief Used to get the client which has missed its deadline before the
+ * last reset.
+ *
+ * @param pClient   Where to store the ID of the client, can be NULL.
+ *
+ * @return  true if the last reset was caused by a missed deadline.
+ */
+bool bspWdgGetMissed(uint32_t *pClient);
+
+/**
+ * @brief Used to add a client, its first deadline starts right away.
+ *
+ * @param client    The ID of the client, 0 to BSP_WDG_CLIENTS - 1.
+ * @param pName     The name used in the crash record, has to be static.
+ * @param timeout   The maximum time between two check ins in ms.
+ *
+ * @return  BSP_OK on success.
+ *          BSP_EBUSY if the client ID is already used.
+ *          BSP_EEINVAL in case of invalid arguments.
+ */
+bspStatus_t bspWdgAdd(uint32_t client, const char *pName, uint32_t timeout);
+
+/**
+ * @brief Used to remove a client, e.g. before it is suspended on purpose.
+ *
+ * @param client    The ID of the client.
+ */
+void bspWdgRemove(uint32_t client);
+
+/**
+ * @brief Used to signal that a client is healthy, can be called from any
+ * context.
+ *
+ * @param client    The ID of the client.
+ */
+void bspWdgCheckIn(uint32_t client);
+
+/**
+ * @brief Used to check the deadlines and to feed the watchdog, called by
+ * the sys tick interrupt.
+ */
+void bspWdgTick(void);
+
+/**
+ * @brief Used to reset the cpu by the watchdog within a few 100us, called
+ * by bspAbort() if BSP_WDG_ABORT_RESET is enabled.
+ */
+void bspWdgExpire(void) __attribute__((noreturn));
+
+#endif /* BSP_WDG == BSP_ENABLED */
+
+#endif /* BSP_NUCLEO_F446_WDG_H_ */
@@ -0,0 +1,102 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+
+#ifndef BSP_NUCLEO_F446_WORK_H_
+#define BSP_NUCLEO_F446_WORK_H_
+
+#include "bsp/bsp.h"
+
+#include <stdint.h>
+
+/**
+ * Deferred work, also known as bottom halves.
+ * 
+ * Interrupts post a function, a context pointer and a argument to a lock 
+ * free queue in constant time and leave the actual work to bspRunPending(),
+ * which runs it in the order of posting outside of any interrupt of the 
+ * bsp. Any number of interrupts may post at the same time, the free slot is
+ * claimed by LDREX/STREX and published by a per slot sequence number. 
+ * 
+ * bspRunPending() has to be called by a single context, either the main 
+ * loop or, if BSP_WORK_PENDSV is enabled, the PendSV exception at 
+ * BSP_IRQPRIO_MIN which is triggered by each post. Hence that the PendSV 
+ * handler is implemented by the bsp in this case.
+ */
+
+#if BSP_WORK == BSP_ENABLED
+
+#ifndef BSP_WORK_SIZE
+
+/**
+ * @brief Number of work items which can be pending, has to be a power of 
+ * two.
+ */
+#define BSP_WORK_SIZE                       16
+
+#endif
+
+/**
+ * @brief A work function.
+ * 
+ * @param pCtx      The context given when posted.
+ * @param arg       The argument given when posted.
+ */
+typedef void (*bspWorkFn_t)(void *pCtx, uint32_t arg);
+
+/**
+ * @brief Used to initialize the work queue, called by bspChipInit().
+ */
+void bspWorkInit(void);
+
+/**
+ * @brief Used to post work, can be called from any context.
+ *
+ * @param fn        The function to run.
+ * @param pCtx      Passed to the function.
+ * @param arg       Passed to the function.
+ *
+ * @return  BSP_OK on success.
+ *          BSP_EBUSY if the queue is full, the item is counted as dropped.
+ *          BSP_EEINVAL if fn is NULL.
+ */
+bspStatus_t bspWorkPost(bspWorkFn_t fn, void *pCtx, uint32_t arg);
+
+/**
+ * @brief Used to run all pending work.
+ * 
+ * Work posted while running is executed as well. Hence that it stops at a 
+ * item which has been claimed but not yet written by a preempted poster, 
+ * the remaining items are run by the next call.
+ *
+ * @return  The number of items run.
+ */
+uint32_t bspRunPending(void);
+
+/**
+ * @brief Used to get the number of items dropped due to a full queue.
+ */
+uint32_t bspWorkGetDropped(void);
+
+#endif /* BSP_WORK == BSP_ENABLED */
+
+#endif /* BSP_NUCLEO_F446_WORK_H_ */
@@ -24,8 +24,10 @@
 
 #include <stm32f4xx_ll_system.h>
 
+#include "bsp/bsp_crash.h"
 #include "bsp/bsp_gpio.h"
 #include "bsp/bsp_tty.h"
+#include "bsp/bsp_wdg.h"
 
 #if BSP_ASSERT == BSP_ENABLED
 
@@ -50,6 +52,30 @@ void bspAbort(const char *pFunc, int line)
     /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
     /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
+#if BSP_CRASH == BSP_ENABLED
+
+#if BSP_ASSERT_MESSAGE == BSP_ENABLED
+
+    bspTTYAssertMessage(buffer);
+
+#endif /* BSP_ASSERT_MESSAGE == BSP_ENABLED */
+
+    /* Recover by a reset, the assertion is reported at the next boot */
+    bspCrashAbort(pFunc, line, (uint32_t) __builtin_return_address(0));
+
+#elif BSP_WDG == BSP_ENABLED && BSP_WDG_ABORT_RESET == BSP_ENABLED
+
+#if BSP_ASSERT_MESSAGE == BSP_ENABLED
+
+    bspTTYAssertMessage(buffer);
+
+#endif /* BSP_ASSERT_MESSAGE == BSP_ENABLED */
+
+    /* Recover by a reset without a record */
+    bspWdgExpire();
+
+#endif /* BSP_CRASH == BSP_ENABLED */
+
     while(1)
     {
        
@@ -0,0 +1,64 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+
+#include <stm32f4xx_ll_bus.h>
+#include <stm32f4xx_ll_pwr.h>
+
+#include "bsp/bsp.h"
+#include "bsp/bsp_bkpsram.h"
+
+void bspBkpSramInit(void)
+{
+    LL_APB1_GRP1_EnableClock(LL_APB1_GRP1_PERIPH_PWR);
+    LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_BKPSRAM);
+
+    /* Cleared by each reset */
+    LL_PWR_EnableBkUpAccess();
+
+#if BSP_BKPSRAM_VBAT == BSP_ENABLED
+
+    /* Keeps the content while running from VBAT */
+    if (!LL_PWR_IsEnabledBkUpRegulator())
+    {
+        LL_PWR_EnableBkUpRegulator();
+        while (!LL_PWR_IsActiveFlag_BRR());
+    }
+
+#endif /* BSP_BKPSRAM_VBAT == BSP_ENABLED */
+}
+
+uint32_t bspBkpSramCrc(const void *pData, uint32_t len)
+{
+    const uint8_t *pByte = (const uint8_t *) pData;
+    uint32_t crc = 0xFFFFFFFFUL;
+
+    while (len--)
+    {
+        crc ^= *pByte++;
+
+        for (uint32_t bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+    }
+
+    return ~crc;
+}
@@ -0,0 +1,389 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+#include <stm32f4xx_ll_dma.h>
+#include <stm32f4xx_ll_tim.h>
+
+#include "bsp/bsp.h"
+#include "bsp/bsp_assert.h"
+#include "bsp/bsp_dma.h"
+#include "bsp/bsp_isr.h"
+#include "bsp/bsp_capture.h"
+
+#include <stdio.h>
+
+#if BSP_CAPTURE == BSP_ENABLED
+
+/**
+ * @brief The timer and its DMA stream, see BSP_CAPTURE_DMA_REQ.
+ */
+#define CAP_TIM                             TIM1
+#define CAP_DMA                             bspDmaGetDma(BSP_CAPTURE_DMA_REQ)
+#define CAP_DMA_STR                         bspDmaGetStream(BSP_CAPTURE_DMA_REQ)
+#define CAP_DMA_CH                          bspDmaGetChannel(BSP_CAPTURE_DMA_REQ)
+
+/**
+ * @brief Number of samples printed per line by the dump functions.
+ */
+#define CAP_DUMP_PER_LINE                   16
+
+/**
+ * @brief Capture data shared with the interrupts.
+ */
+static struct
+{
+    bspCaptureMode_t Mode;
+    uint16_t *pBuf[2];
+    uint16_t Len;
+    uint16_t Pre;
+    uint16_t Post;
+    bspCaptureCb_t Cb;
+    void *pCtx;
+    uint32_t Rate;
+    volatile bool Busy;
+
+    /* Trigger mode only */
+    uint32_t Halves;
+    bool StopNext;
+    volatile uint16_t TrigIdx;
+    volatile uint16_t TrigPre;
+    uint16_t Lost;
+    volatile bool Triggered;
+    volatile bool Done;
+
+} capData;
+
+/**
+ * @brief Calls the user callback, if any.
+ */
+static inline void captureCallback(uint16_t *pBuf, uint16_t len)
+{
+    if (capData.Cb != 0)
+        capData.Cb(pBuf, len, capData.pCtx);
+}
+
+/**
+ * @brief Stops a triggered capture and drops the pre trigger samples which 
+ * have been overwritten until the stop, e.g. during the interrupt latency.
+ */
+static void captureFinish(void)
+{
+    uint16_t idx, written, avail;
+
+    /* No further requests, so the position is final */
+    LL_TIM_DisableCounter(CAP_TIM);
+
+    idx = capData.Len - LL_DMA_GetDataLength(CAP_DMA, CAP_DMA_STR);
+    written = (idx + capData.Len - capData.TrigIdx) % capData.Len;
+    avail = capData.Len - written;
+
+    if (capData.TrigPre > avail)
+    {
+        capData.Lost = capData.TrigPre - avail;
+        capData.TrigPre = avail;
+    }
+
+    bspCaptureStop();
+    capData.Done = true;
+    captureCallback(capData.pBuf[0], capData.Len);
+}
+
+/**
+ * @brief Called in trigger mode whenever the stream has passed the middle 
+ * or the end of the buffer.
+ * 
+ * @param idx   The index of the next sample to be written.
+ */
+static void captureBoundary(uint16_t idx)
+{
+    uint32_t dist;
+
+    if (capData.Halves < 2)
+        capData.Halves++;
+
+    if (!capData.Triggered)
+        return;
+
+    if (!capData.StopNext)
+    {
+        /* Samples taken since the trigger, in the range 1..Len */
+        dist = (idx + capData.Len - capData.TrigIdx - 1) % capData.Len + 1;
+
+        /* The trigger is located after this boundary, as it has been taken 
+         * before this interrupt was served */
+        if (dist > capData.Len / 2u)
+            return;
+
+        if (dist < capData.Post)
+        {
+            capData.StopNext = true;
+            return;
+        }
+    }
+
+    captureFinish();
+}
+
+/**
+ * @brief Capture DMA interrupt handler, called by the stream interrupt.
+ */
+static void captureDmaIsr(uint32_t flags, void *pCtx)
+{
+    BSP_ISR_ENTER(BSP_ISR_CAPTURE);
+
+    if (flags & BSP_DMA_FLAG_TE)
+    {
+        /* Most likely a buffer in a region the DMA can not access */
+        bspCaptureStop();
+        bspDoAssert();
+        flags = 0;
+    }
+
+    if (flags & BSP_DMA_FLAG_HT)
+    {
+        captureBoundary(capData.Len / 2);
+    }
+
+    if (flags & BSP_DMA_FLAG_TC)
+    {
+
+        switch (capData.Mode)
+        {
+            case BSP_CAPTURE_ONESHOT:
+
+                bspCaptureStop();
+                captureCallback(capData.pBuf[0], capData.Len);
+                break;
+
+            case BSP_CAPTURE_STREAM:
+
+                /* The stream has already switched to the other buffer */
+                if (LL_DMA_GetCurrentTargetMem(CAP_DMA, CAP_DMA_STR) == 
+                    LL_DMA_CURRENTTARGETMEM1)
+                    captureCallback(capData.pBuf[0], capData.Len);
+                else
+                    captureCallback(capData.pBuf[1], capData.Len);
+                break;
+
+            case BSP_CAPTURE_TRIGGER:
+
+                captureBoundary(0);
+                break;
+        }
+    }
+
+    BSP_ISR_EXIT(BSP_ISR_CAPTURE);
+}
+
+void bspCaptureInit(void)
+{
+    capData.Busy = false;
+
+    bspDmaClaim(BSP_CAPTURE_DMA_REQ, captureDmaIsr, NULL, BSP_IRQPRIO_CAPTURE);
+}
+
+bspStatus_t bspCaptureStart(const bspCaptureCfg_t *pCfg)
+{
+    LL_DMA_InitTypeDef dma;
+    uint32_t clk = bspGetTimClock(CAP_TIM);
+
+    if (capData.Busy)
+        return BSP_EBUSY;
+
+    /* The timer needs a auto reload value of at least 1 */
+    if (   pCfg->pBuf[0] == 0 || pCfg->Len == 0
+        || pCfg->RateHz == 0 || pCfg->RateHz > clk / 2)
+        return BSP_EEINVAL;
+
+    if (pCfg->Mode == BSP_CAPTURE_STREAM && pCfg->pBuf[1] == 0)
+        return BSP_EEINVAL;
+
+    if (   pCfg->Mode == BSP_CAPTURE_TRIGGER 
+        && (   (pCfg->Len & 1) != 0
+            || (uint32_t) pCfg->Pre + pCfg->Post > pCfg->Len / 2u))
+        return BSP_EEINVAL;
+
+    capData.Mode = pCfg->Mode;
+    capData.pBuf[0] = pCfg->pBuf[0];
+    capData.pBuf[1] = pCfg->pBuf[1];
+    capData.Len = pCfg->Len;
+    capData.Pre = pCfg->Pre;
+    capData.Post = pCfg->Post;
+    capData.Cb = pCfg->Cb;
+    capData.pCtx = pCfg->pCtx;
+    capData.Halves = 0;
+    capData.StopNext = false;
+    capData.Triggered = false;
+    capData.Done = false;
+    capData.Lost = 0;
+
+    /* Load the prescaler while the dma request is still disabled, otherwise 
+     * the update event would already trigger a transfer */
+    capData.Rate = bspTimSetRate(CAP_TIM, pCfg->RateHz);
+
+    LL_DMA_StructInit(&dma);
+    dma.Channel = CAP_DMA_CH;
+    dma.Mode = pCfg->Mode == BSP_CAPTURE_ONESHOT ? 
+        LL_DMA_MODE_NORMAL : LL_DMA_MODE_CIRCULAR;
+    dma.Direction = LL_DMA_DIRECTION_PERIPH_TO_MEMORY;
+    dma.Priority = LL_DMA_PRIORITY_VERYHIGH;
+    dma.MemoryOrM2MDstIncMode = LL_DMA_MEMORY_INCREMENT;
+    dma.PeriphOrM2MSrcIncMode = LL_DMA_PERIPH_NOINCREMENT;
+    dma.MemoryOrM2MDstDataSize = LL_DMA_MDATAALIGN_HALFWORD;
+    dma.PeriphOrM2MSrcDataSize = LL_DMA_PDATAALIGN_HALFWORD;
+    dma.PeriphOrM2MSrcAddress = (uint32_t) &BSP_IOMAPPORT(pCfg->Port)->IDR;
+    dma.MemoryOrM2MDstAddress = (uint32_t) pCfg->pBuf[0];
+    dma.NbData = pCfg->Len;
+    LL_DMA_Init(CAP_DMA, CAP_DMA_STR, &dma);
+
+    if (pCfg->Mode == BSP_CAPTURE_STREAM)
+    {
+        LL_DMA_SetMemory1Address(CAP_DMA, CAP_DMA_STR, 
+            (uint32_t) pCfg->pBuf[1]);
+        LL_DMA_SetCurrentTargetMem(CAP_DMA, CAP_DMA_STR, 
+            LL_DMA_CURRENTTARGETMEM0);
+        LL_DMA_EnableDoubleBufferMode(CAP_DMA, CAP_DMA_STR);
+    }
+    else
+    {
+        LL_DMA_DisableDoubleBufferMode(CAP_DMA, CAP_DMA_STR);
+    }
+
+    if (pCfg->Mode == BSP_CAPTURE_TRIGGER)
+        LL_DMA_EnableIT_HT(CAP_DMA, CAP_DMA_STR);
+    else
+        LL_DMA_DisableIT_HT(CAP_DMA, CAP_DMA_STR);
+
+    LL_DMA_EnableIT_TC(CAP_DMA, CAP_DMA_STR);
+    LL_DMA_EnableIT_TE(CAP_DMA, CAP_DMA_STR);
+
+    capData.Busy = true;
+
+    LL_DMA_EnableStream(CAP_DMA, CAP_DMA_STR);
+    LL_TIM_EnableDMAReq_UPDATE(CAP_TIM);
+    LL_TIM_EnableCounter(CAP_TIM);
+
+    return BSP_OK;
+}
+
+void bspCaptureStop(void)
+{
+    LL_TIM_DisableCounter(CAP_TIM);
+    LL_TIM_DisableDMAReq_UPDATE(CAP_TIM);
+
+    bspDmaStop(BSP_CAPTURE_DMA_REQ);
+
+    capData.Busy = false;
+}
+
+bool bspCaptureIsBusy(void)
+{
+    return capData.Busy;
+}
+
+uint32_t bspCaptureGetRate(void)
+{
+    return capData.Rate;
+}
+
+void bspCaptureTrigger(void)
+{
+    uint16_t idx;
+
+    if (   !capData.Busy || capData.Mode != BSP_CAPTURE_TRIGGER 
+        || capData.Triggered)
+        return;
+
+    idx = capData.Len - LL_DMA_GetDataLength(CAP_DMA, CAP_DMA_STR);
+    if (idx == capData.Len)
+        idx = 0;
+
+    /* Before the first wrap around only the samples taken so far are valid */
+    if (capData.Halves >= 2 || idx >= capData.Pre)
+        capData.TrigPre = capData.Pre;
+    else
+        capData.TrigPre = idx;
+
+    capData.TrigIdx = idx;
+    capData.Triggered = true;
+}
+
+void bspCaptureExtiCb(void *pCtx)
+{
+    bspCaptureTrigger();
+}
+
+bspStatus_t bspCaptureGetWindow(bspCaptureWindow_t *pWin)
+{
+    if (!capData.Done)
+        return BSP_EBUSY;
+
+    pWin->pBuf = capData.pBuf[0];
+    pWin->Len = capData.Len;
+    pWin->Start = (capData.TrigIdx + capData.Len - capData.TrigPre) % 
+        capData.Len;
+    pWin->Cnt = capData.TrigPre + capData.Post;
+    pWin->Pre = capData.TrigPre;
+    pWin->Lost = capData.Lost;
+
+    return BSP_OK;
+}
+
+/**
+ * @brief Prints the header of a dump.
+ */
+static void captureDumpHeader(uint16_t cnt, uint16_t pre)
+{
+    printf("#cap %lu %u %u\n", (unsigned long) capData.Rate, cnt, pre);
+}
+
+/**
+ * @brief Prints a single sample.
+ */
+static inline void captureDumpSample(uint16_t sample, uint16_t n, 
+    uint16_t cnt)
+{
+    printf("%04x%c", sample, 
+        ((n + 1) % CAP_DUMP_PER_LINE == 0 || n + 1 == cnt) ? '\n' : ' ');
+}
+
+void bspCaptureDump(const uint16_t *pBuf, uint16_t len)
+{
+    captureDumpHeader(len, 0);
+
+    for (uint16_t n = 0; n < len; n++)
+        captureDumpSample(pBuf[n], n, len);
+
+    printf("#end\n");
+}
+
+void bspCaptureDumpWindow(const bspCaptureWindow_t *pWin)
+{
+    captureDumpHeader(pWin->Cnt, pWin->Pre);
+
+    for (uint16_t n = 0; n < pWin->Cnt; n++)
+        captureDumpSample(bspCaptureSample(pWin, n), n, pWin->Cnt);
+
+    printf("#end\n");
+}
+
+#endif /* BSP_CAPTURE == BSP_ENABLED */
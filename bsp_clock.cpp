@@ -0,0 +1,309 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+
+#include <stm32f4xx_ll_rcc.h>
+#include <stm32f4xx_ll_pwr.h>
+#include <stm32f4xx_ll_system.h>
+#include <stm32f4xx_ll_utils.h>
+
+#include "bsp/bsp.h"
+#include "bsp/bsp_clock.h"
+#include "bsp/bsp_tty.h"
+
+#include <stddef.h>
+
+/**
+ * @brief SYSCLK of the low power profile for the given input clock.
+ */
+#define CLOCK_LOWPOWER_HZ(_inHz)            (BSP_CLOCK_LOWPOWER_HZ == 0 ? \
+                                            (_inHz) : BSP_CLOCK_LOWPOWER_HZ)
+
+/**
+ * @brief The predefined profiles per source, order as in bspClockSrc_t and
+ * bspClockProfile_t.
+ */
+static constexpr bspClockCfg_t clockProfiles[BSP_CLOCK_SRC_CNT][BSP_CLOCK_CNT] =
+{
+    {
+        bspClockSolve(BSP_HSE_HZ, BSP_CLOCK_PERFORMANCE_HZ, BSP_CLOCK_SRC_HSE),
+        bspClockSolve(BSP_HSE_HZ, BSP_CLOCK_BALANCED_HZ, BSP_CLOCK_SRC_HSE),
+        bspClockSolve(BSP_HSE_HZ, CLOCK_LOWPOWER_HZ(BSP_HSE_HZ),
+            BSP_CLOCK_SRC_HSE),
+    },
+    {
+        bspClockSolve(BSP_HSI_HZ, BSP_CLOCK_PERFORMANCE_HZ, BSP_CLOCK_SRC_HSI),
+        bspClockSolve(BSP_HSI_HZ, BSP_CLOCK_BALANCED_HZ, BSP_CLOCK_SRC_HSI),
+        bspClockSolve(BSP_HSI_HZ, CLOCK_LOWPOWER_HZ(BSP_HSI_HZ),
+            BSP_CLOCK_SRC_HSI),
+    },
+};
+
+BSP_CLOCK_CHECK(clockProfiles[BSP_CLOCK_SRC_HSE][BSP_CLOCK_PERFORMANCE]);
+BSP_CLOCK_CHECK(clockProfiles[BSP_CLOCK_SRC_HSE][BSP_CLOCK_BALANCED]);
+BSP_CLOCK_CHECK(clockProfiles[BSP_CLOCK_SRC_HSE][BSP_CLOCK_LOWPOWER]);
+BSP_CLOCK_CHECK(clockProfiles[BSP_CLOCK_SRC_HSI][BSP_CLOCK_PERFORMANCE]);
+BSP_CLOCK_CHECK(clockProfiles[BSP_CLOCK_SRC_HSI][BSP_CLOCK_BALANCED]);
+BSP_CLOCK_CHECK(clockProfiles[BSP_CLOCK_SRC_HSI][BSP_CLOCK_LOWPOWER]);
+
+/**
+ * @brief Clock module state.
+ */
+static struct
+{
+    bspClockSrc_t Src;
+    bspClockProfile_t Profile;
+    uint32_t SwitchCycle;
+
+} clockData = {BSP_CLOCK_SRC_HSI, BSP_CLOCK_CNT, 0};
+
+/**
+ * @brief Returns the RCC_CFGR PPREx value of the given APB prescaler.
+ */
+static inline uint32_t clockApbBits(uint32_t div)
+{
+    if (div <= 1)
+        return 0;
+
+    /* 0b100 is /2, 0b101 /4 and so on */
+    return 3 + (31 - __CLZ(div));
+}
+
+/**
+ * @brief Returns the LL regulator voltage scale value.
+ */
+static inline uint32_t clockVos(uint32_t vos)
+{
+    switch (vos)
+    {
+        case 1:
+            return LL_PWR_REGU_VOLTAGE_SCALE1;
+
+        case 2:
+            return LL_PWR_REGU_VOLTAGE_SCALE2;
+
+        default:
+            return LL_PWR_REGU_VOLTAGE_SCALE3;
+    }
+}
+
+/**
+ * @brief Runs the core from the HSI so that the PLL can be reconfigured.
+ */
+static inline void clockToHsi(void)
+{
+    LL_RCC_HSI_Enable();
+    while(LL_RCC_HSI_IsReady() != 1);
+
+    LL_RCC_SetSysClkSource(LL_RCC_SYS_CLKSOURCE_HSI);
+    while(LL_RCC_GetSysClkSource() != LL_RCC_SYS_CLKSOURCE_STATUS_HSI);
+
+    LL_RCC_PLL_Disable();
+    while(LL_RCC_PLL_IsReady() != 0);
+}
+
+/**
+ * @brief Sets the flash wait states and the bus prescalers of the given 
+ * configuration. Called while running from the HSI, so the wait states of
+ * the target are fine.
+ */
+static void clockBusInit(const bspClockCfg_t *pCfg)
+{
+    LL_FLASH_SetLatency(pCfg->Latency);
+    while(LL_FLASH_GetLatency() != pCfg->Latency);
+
+    LL_RCC_SetAHBPrescaler(LL_RCC_SYSCLK_DIV_1);
+    LL_RCC_SetAPB1Prescaler(clockApbBits(pCfg->Apb1Div) << RCC_CFGR_PPRE1_Pos);
+    LL_RCC_SetAPB2Prescaler(clockApbBits(pCfg->Apb2Div) << RCC_CFGR_PPRE2_Pos);
+}
+
+/**
+ * @brief Configures and starts the PLL and runs the core from it, called 
+ * while running from the HSI with the PLL turned off.
+ */
+static void clockPllStart(const bspClockCfg_t *pCfg)
+{
+    MODIFY_REG(RCC->PLLCFGR,
+        RCC_PLLCFGR_PLLSRC | RCC_PLLCFGR_PLLM | RCC_PLLCFGR_PLLN | 
+        RCC_PLLCFGR_PLLP | RCC_PLLCFGR_PLLQ,
+        (pCfg->Src == BSP_CLOCK_SRC_HSE ? 
+            LL_RCC_PLLSOURCE_HSE : LL_RCC_PLLSOURCE_HSI) | 
+        (pCfg->M << RCC_PLLCFGR_PLLM_Pos) | 
+        (pCfg->N << RCC_PLLCFGR_PLLN_Pos) | 
+        ((pCfg->P / 2 - 1) << RCC_PLLCFGR_PLLP_Pos) | 
+        (pCfg->Q << RCC_PLLCFGR_PLLQ_Pos));
+
+    clockBusInit(pCfg);
+
+    LL_RCC_PLL_Enable();
+    while(LL_RCC_PLL_IsReady() != 1);
+
+    if (pCfg->OverDrive)
+    {
+        LL_PWR_EnableOverDriveMode();
+        while(LL_PWR_IsActiveFlag_OD() != 1);
+
+        LL_PWR_EnableOverDriveSwitching();
+        while(LL_PWR_IsActiveFlag_ODSW() != 1);
+    }
+
+    while(LL_PWR_IsActiveFlag_VOS() != 1);
+
+    LL_RCC_SetSysClkSource(LL_RCC_SYS_CLKSOURCE_PLL);
+    while(LL_RCC_GetSysClkSource() != LL_RCC_SYS_CLKSOURCE_STATUS_PLL);
+}
+
+/**
+ * @brief Runs the core straight from the PLL input clock, called while 
+ * running from the HSI with the PLL turned off.
+ */
+static void clockDirect(const bspClockCfg_t *pCfg)
+{
+    clockBusInit(pCfg);
+
+    if (pCfg->Src == BSP_CLOCK_SRC_HSE)
+    {
+        LL_RCC_SetSysClkSource(LL_RCC_SYS_CLKSOURCE_HSE);
+        while(LL_RCC_GetSysClkSource() != LL_RCC_SYS_CLKSOURCE_STATUS_HSE);
+
+        /* Enabled again by clockToHsi() */
+        LL_RCC_HSI_Disable();
+    }
+}
+
+bspClockSrc_t bspClockStart(void)
+{
+    clockData.Src = BSP_CLOCK_SRC_HSI;
+
+#if BSP_CLOCKSRC_HSI != BSP_ENABLED
+
+    uint32_t start = bspGetCycleCount();
+
+    LL_RCC_HSE_EnableBypass();
+    LL_RCC_HSE_Enable();
+
+    while(LL_RCC_HSE_IsReady() != 1)
+    {
+        if (bspGetCycleCount() - start > 
+            BSP_CLOCK_HSE_TIMEOUT_US * (BSP_HSI_HZ / 1000000))
+            break;
+    }
+
+    if (LL_RCC_HSE_IsReady() == 1)
+        clockData.Src = BSP_CLOCK_SRC_HSE;
+    else
+        LL_RCC_HSE_Disable();
+
+#endif /* BSP_CLOCKSRC_HSI != BSP_ENABLED */
+
+    return clockData.Src;
+}
+
+bspClockSrc_t bspClockGetSource(void)
+{
+    return clockData.Src;
+}
+
+const bspClockCfg_t *bspClockGetCfg(bspClockProfile_t profile)
+{
+    if (profile >= BSP_CLOCK_CNT)
+        return NULL;
+
+    return &clockProfiles[clockData.Src][profile];
+}
+
+bspStatus_t bspClockApply(const bspClockCfg_t *pCfg)
+{
+    uint32_t crit = 0;
+
+    if (pCfg == NULL || !pCfg->Valid)
+        return BSP_EEINVAL;
+
+    if (pCfg->Src == BSP_CLOCK_SRC_HSE && LL_RCC_HSE_IsReady() != 1)
+        return BSP_ERR;
+
+    /* Do not change the baud rate in the middle of a character */
+    bspTTYFlush();
+
+    crit = bspCriticalEnter();
+
+    clockToHsi();
+
+    /* Over-drive may only be left while not running from the PLL, the 
+     * voltage scale takes effect as soon as the PLL is enabled */
+    if (!pCfg->OverDrive)
+    {
+        LL_PWR_DisableOverDriveSwitching();
+        LL_PWR_DisableOverDriveMode();
+    }
+
+    LL_PWR_SetRegulVoltageScaling(clockVos(pCfg->Vos));
+
+    if (pCfg->Pll)
+        clockPllStart(pCfg);
+    else
+        clockDirect(pCfg);
+
+    clockData.SwitchCycle = bspGetCycleCount();
+
+    LL_SetSystemCoreClock(pCfg->SysClk);
+    LL_Init1msTick(pCfg->SysClk);
+
+#if BSP_SYSTICK == BSP_ENABLED
+
+    /* LL_Init1msTick() does not enable the interrupt */
+    SysTick->CTRL  |= SysTick_CTRL_TICKINT_Msk;
+
+#endif /* BSP_SYSTICK == BSP_ENABLED */
+
+    bspTTYClockUpdate();
+
+    clockData.Profile = BSP_CLOCK_CNT;
+    bspCriticalExit(crit);
+
+    return BSP_OK;
+}
+
+bspStatus_t bspClockSetProfile(bspClockProfile_t profile)
+{
+    bspStatus_t ret = BSP_OK;
+
+    if (profile >= BSP_CLOCK_CNT)
+        return BSP_EEINVAL;
+
+    ret = bspClockApply(&clockProfiles[clockData.Src][profile]);
+
+    if (ret == BSP_OK)
+        clockData.Profile = profile;
+
+    return ret;
+}
+
+bspClockProfile_t bspClockGetProfile(void)
+{
+    return clockData.Profile;
+}
+
+uint32_t bspClockGetSwitchCycle(void)
+{
+    return clockData.SwitchCycle;
+}
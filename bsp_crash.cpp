@@ -0,0 +1,355 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+
+#include <stm32f4xx_ll_rcc.h>
+
+#include "bsp/bsp.h"
+#include "bsp/bsp_bkpsram.h"
+#include "bsp/bsp_crash.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#if BSP_CRASH == BSP_ENABLED
+
+static_assert(sizeof(bspCrashRecord_t) <= BSP_BKPSRAM_CRASH_SIZE, 
+    "The crash record does not fit into its backup SRAM region");
+
+/**
+ * @brief Marks a written record, "CRSH".
+ */
+#define CRASH_MAGIC                         0x48535243UL
+
+/**
+ * @brief The SRAM the stack can be located in, SRAM1 and SRAM2.
+ */
+#define CRASH_RAM_START                     SRAM1_BASE
+#define CRASH_RAM_END                       (SRAM2_BASE + 0x4000UL)
+
+/**
+ * @brief The record in the backup SRAM.
+ */
+#define CRASH_REC                           ((bspCrashRecord_t *) \
+                                            bspBkpSramAddr(BSP_BKPSRAM_CRASH_OFS))
+
+/**
+ * @brief Size of the stack the fault handlers switch to in bytes, enough for
+ * crashFault() and the functions it calls.
+ */
+#define CRASH_FAULT_STACK                   256
+#define CRASH_STR(_x)                       CRASH_STR2(_x)
+#define CRASH_STR2(_x)                      #_x
+
+/**
+ * @brief The stack used to record a fault, as the faulting one may be 
+ * broken or overflowed.
+ */
+extern "C" 
+{
+    uint32_t crashFaultStack[CRASH_FAULT_STACK / 4] 
+        __attribute__((aligned(8), used));
+}
+
+/**
+ * @brief Used to implement the fault handler _vector as naked entry which 
+ * passes the stack frame and EXC_RETURN to crashFault() running on 
+ * crashFaultStack.
+ */
+#define CRASH_HANDLER(_vector, _type)                                       \
+                                                                            \
+    extern "C" void _vector##Crash(bspExcFrame_t *pFrame,                   \
+        uint32_t excReturn) __attribute__((noreturn, used));                \
+                                                                            \
+    extern "C" __attribute__((naked)) void _vector(void)                    \
+    {                                                                       \
+        __asm volatile(                                                     \
+            "tst    lr, #4          \n"                                     \
+            "ite    eq              \n"                                     \
+            "mrseq  r0, msp         \n"                                     \
+            "mrsne  r0, psp         \n"                                     \
+            "mov    r1, lr          \n"                                     \
+            "movw   r2, #:lower16:crashFaultStack + "                       \
+                CRASH_STR(CRASH_FAULT_STACK) "\n"                           \
+            "movt   r2, #:upper16:crashFaultStack + "                       \
+                CRASH_STR(CRASH_FAULT_STACK) "\n"                           \
+            "mov    sp, r2          \n"                                     \
+            "b      " #_vector "Crash \n");                                 \
+    }                                                                       \
+                                                                            \
+    extern "C" void _vector##Crash(bspExcFrame_t *pFrame,                   \
+        uint32_t excReturn)                                                 \
+    {                                                                       \
+        crashFault(pFrame, excReturn, _type);                               \
+    }
+
+/**
+ * @brief Names used when printing a record, order as in bspCrashType_t.
+ */
+static const char *crashNames[BSP_CRASH_CNT] =
+{
+    "none",
+    "hard fault",
+    "mem manage",
+    "bus fault",
+    "usage fault",
+    "assert",
+    "watchdog",
+};
+
+/**
+ * @brief The record of the previous run, copied from the backup SRAM.
+ */
+static struct
+{
+    bspCrashRecord_t Last;
+    bool Valid;
+    uint32_t ResetFlags;
+
+} crashData;
+
+/**
+ * @brief The reset flags of RCC_CSR which are reported.
+ */
+#define CRASH_RST_LPWR                      0x01
+#define CRASH_RST_WWDG                      0x02
+#define CRASH_RST_IWDG                      0x04
+#define CRASH_RST_SW                        0x08
+#define CRASH_RST_POR                       0x10
+#define CRASH_RST_PIN                       0x20
+#define CRASH_RST_BOR                       0x40
+
+/**
+ * @brief Returns true if the given range is within the SRAM and aligned, 
+ * so it can be read without causing a further fault.
+ */
+static inline bool crashInRam(uint32_t addr, uint32_t len)
+{
+    return (addr & 3) == 0 && addr >= CRASH_RAM_START && 
+        addr + len <= CRASH_RAM_END;
+}
+
+/**
+ * @brief Clears the record and copies the fault status registers.
+ */
+static bspCrashRecord_t *crashBegin(uint32_t type)
+{
+    bspCrashRecord_t *pRec = CRASH_REC;
+
+    bspBkpSramInit();
+    memset(pRec, 0, sizeof(bspCrashRecord_t));
+
+    pRec->Type = type;
+    pRec->Cfsr = SCB->CFSR;
+    pRec->Hfsr = SCB->HFSR;
+    pRec->Mmfar = SCB->MMFAR;
+    pRec->Bfar = SCB->BFAR;
+
+#if BSP_SYSTICK == BSP_ENABLED
+
+    pRec->Tick = bspGetSysTick();
+
+#endif /* BSP_SYSTICK == BSP_ENABLED */
+
+    return pRec;
+}
+
+/**
+ * @brief Copies the stack words starting at the given address.
+ */
+static void crashStack(bspCrashRecord_t *pRec, uint32_t addr)
+{
+    for (uint32_t i = 0; i < BSP_CRASH_STACK_WORDS; i++)
+    {
+        if (!crashInRam(addr + i * 4, 4))
+            break;
+
+        pRec->Stack[i] = ((uint32_t *) addr)[i];
+    }
+}
+
+/**
+ * @brief Validates the record.
+ */
+static void crashSeal(bspCrashRecord_t *pRec)
+{
+    pRec->Magic = CRASH_MAGIC;
+    pRec->Crc = bspBkpSramCrc(pRec, offsetof(bspCrashRecord_t, Crc));
+}
+
+/**
+ * @brief Validates the record and resets the cpu.
+ */
+static void __attribute__((noreturn)) crashCommit(bspCrashRecord_t *pRec)
+{
+    crashSeal(pRec);
+    NVIC_SystemReset();
+}
+
+/**
+ * @brief Records a fault and resets the cpu.
+ */
+static void __attribute__((noreturn)) crashFault(bspExcFrame_t *pFrame, 
+    uint32_t excReturn, uint32_t type)
+{
+    bspCrashRecord_t *pRec = crashBegin(type);
+    uint32_t sp = (uint32_t) pFrame;
+
+    /* Bit 4 cleared means a extended frame including the fpu registers */
+    uint32_t frameSize = (excReturn & 0x10) ? 8 * 4 : 26 * 4;
+
+    pRec->ExcReturn = excReturn;
+    pRec->Sp = sp;
+
+    /* A broken stack pointer is a common cause of faults */
+    if (crashInRam(sp, sizeof(bspExcFrame_t)))
+    {
+        pRec->Frame = *pFrame;
+        crashStack(pRec, sp + frameSize);
+    }
+
+    crashCommit(pRec);
+}
+
+CRASH_HANDLER(HardFault_Handler, BSP_CRASH_HARDFAULT)
+CRASH_HANDLER(MemManage_Handler, BSP_CRASH_MEMMANAGE)
+CRASH_HANDLER(BusFault_Handler, BSP_CRASH_BUSFAULT)
+CRASH_HANDLER(UsageFault_Handler, BSP_CRASH_USAGEFAULT)
+
+void bspCrashAbort(const char *pFunc, int line, uint32_t pc)
+{
+    bspCrashRecord_t *pRec = crashBegin(BSP_CRASH_ASSERT);
+    uint32_t sp = __get_MSP();
+
+    if (__get_IPSR() == 0 && (__get_CONTROL() & 2) != 0)
+        sp = __get_PSP();
+
+    pRec->Sp = sp;
+    pRec->Frame.Pc = pc;
+    pRec->Line = line;
+    strncpy(pRec->Func, pFunc, sizeof(pRec->Func) - 1);
+    crashStack(pRec, sp);
+
+    crashCommit(pRec);
+}
+
+void bspCrashWatchdog(uint32_t client, const char *pName)
+{
+    bspCrashRecord_t *pRec = crashBegin(BSP_CRASH_WATCHDOG);
+
+    pRec->Line = client;
+    strncpy(pRec->Func, pName, sizeof(pRec->Func) - 1);
+
+    crashSeal(pRec);
+}
+
+void bspCrashInit(void)
+{
+    bspCrashRecord_t *pRec = CRASH_REC;
+
+    /* Otherwise all of them escalate to the hard fault */
+    SCB->SHCSR |= SCB_SHCSR_MEMFAULTENA_Msk | SCB_SHCSR_BUSFAULTENA_Msk | 
+        SCB_SHCSR_USGFAULTENA_Msk;
+
+    crashData.ResetFlags = 
+        (LL_RCC_IsActiveFlag_LPWRRST() ? CRASH_RST_LPWR : 0) |
+        (LL_RCC_IsActiveFlag_WWDGRST() ? CRASH_RST_WWDG : 0) |
+        (LL_RCC_IsActiveFlag_IWDGRST() ? CRASH_RST_IWDG : 0) |
+        (LL_RCC_IsActiveFlag_SFTRST() ? CRASH_RST_SW : 0) |
+        (LL_RCC_IsActiveFlag_PORRST() ? CRASH_RST_POR : 0) |
+        (LL_RCC_IsActiveFlag_PINRST() ? CRASH_RST_PIN : 0) |
+        (LL_RCC_IsActiveFlag_BORRST() ? CRASH_RST_BOR : 0);
+    LL_RCC_ClearResetFlags();
+
+    bspBkpSramInit();
+
+    if (pRec->Magic == CRASH_MAGIC && pRec->Type < BSP_CRASH_CNT &&
+        pRec->Crc == bspBkpSramCrc(pRec, offsetof(bspCrashRecord_t, Crc)))
+    {
+        crashData.Last = *pRec;
+        crashData.Valid = true;
+    }
+
+    /* Report a record only once */
+    pRec->Magic = 0;
+}
+
+void bspCrashReport(void)
+{
+    bspCrashRecord_t *pRec = &crashData.Last;
+
+    printf("bsp: reset by%s%s%s%s%s%s%s\n",
+        crashData.ResetFlags & CRASH_RST_LPWR ? " lpwr" : "",
+        crashData.ResetFlags & CRASH_RST_WWDG ? " wwdg" : "",
+        crashData.ResetFlags & CRASH_RST_IWDG ? " iwdg" : "",
+        crashData.ResetFlags & CRASH_RST_SW ? " sw" : "",
+        crashData.ResetFlags & CRASH_RST_POR ? " por" : "",
+        crashData.ResetFlags & CRASH_RST_PIN ? " pin" : "",
+        crashData.ResetFlags & CRASH_RST_BOR ? " bor" : "");
+
+    if (!crashData.Valid)
+        return;
+
+    printf("bsp: crash, %s at tick %lu\n", crashNames[pRec->Type], 
+        (unsigned long) pRec->Tick);
+
+    if (pRec->Type == BSP_CRASH_ASSERT)
+        printf("  %s(%lu)\n", pRec->Func, (unsigned long) pRec->Line);
+
+    /* No registers recorded in this case */
+    if (pRec->Type == BSP_CRASH_WATCHDOG)
+    {
+        printf("  client %lu %s\n", (unsigned long) pRec->Line, pRec->Func);
+        return;
+    }
+
+    printf("  pc   %08lx lr   %08lx psr  %08lx sp   %08lx\n",
+        (unsigned long) pRec->Frame.Pc, (unsigned long) pRec->Frame.Lr, 
+        (unsigned long) pRec->Frame.Psr, (unsigned long) pRec->Sp);
+    printf("  r0   %08lx r1   %08lx r2   %08lx r3   %08lx r12  %08lx\n",
+        (unsigned long) pRec->Frame.R0, (unsigned long) pRec->Frame.R1, 
+        (unsigned long) pRec->Frame.R2, (unsigned long) pRec->Frame.R3, 
+        (unsigned long) pRec->Frame.R12);
+    printf("  cfsr %08lx hfsr %08lx mmfar %08lx bfar %08lx exc %08lx\n",
+        (unsigned long) pRec->Cfsr, (unsigned long) pRec->Hfsr, 
+        (unsigned long) pRec->Mmfar, (unsigned long) pRec->Bfar,
+        (unsigned long) pRec->ExcReturn);
+    printf("  stack");
+
+    for (uint32_t i = 0; i < BSP_CRASH_STACK_WORDS; i++)
+        printf(" %08lx", (unsigned long) pRec->Stack[i]);
+
+    printf("\n");
+}
+
+bspStatus_t bspCrashGetLast(bspCrashRecord_t *pRec)
+{
+    if (!crashData.Valid)
+        return BSP_EEMPTY;
+
+    memcpy(pRec, &crashData.Last, sizeof(bspCrashRecord_t));
+
+    return BSP_OK;
+}
+
+#endif /* BSP_CRASH == BSP_ENABLED */
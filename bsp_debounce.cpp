@@ -0,0 +1,218 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+#include "bsp/bsp.h"
+#include "bsp/bsp_debounce.h"
+
+#if BSP_DEBOUNCE == BSP_ENABLED
+
+#if BSP_DEBOUNCE_SAMPLES < 1 || BSP_DEBOUNCE_SAMPLES > 8
+#error BSP_DEBOUNCE_SAMPLES has to be in the range 1 to 8
+#endif
+
+#if (BSP_DEBOUNCE_QUEUE & (BSP_DEBOUNCE_QUEUE - 1)) != 0
+#error BSP_DEBOUNCE_QUEUE has to be a power of two
+#endif
+
+/**
+ * @brief The history bits which have to agree for a state change.
+ */
+#define DEB_HIST_MASK                       ((1U << BSP_DEBOUNCE_SAMPLES) - 1)
+
+/**
+ * @brief Debounce data shared with the sys tick interrupt.
+ */
+static struct
+{
+    struct
+    {
+        GPIO_TypeDef *pPort;
+        uint16_t Mask;
+        bool ActiveLow;
+        volatile bool Used;
+        uint8_t Hist;
+        volatile bool Active;
+        bool Long;
+        uint32_t Since;
+        uint32_t Next;
+
+    } In[BSP_DEBOUNCE_NUM];
+
+    bspDebounceEvent_t Queue[BSP_DEBOUNCE_QUEUE];
+    volatile uint32_t Head;
+    volatile uint32_t Tail;
+    uint32_t Lost;
+    uint32_t Div;
+
+} debData;
+
+/**
+ * @brief Writes a event to the queue, called by the sys tick interrupt.
+ */
+static void debouncePut(uint32_t input, bspDebounceEvType_t type, 
+    uint32_t now)
+{
+    uint32_t head = debData.Head;
+    bspDebounceEvent_t *pEv;
+
+    if (head - debData.Tail >= BSP_DEBOUNCE_QUEUE)
+    {
+        debData.Lost++;
+        return;
+    }
+
+    pEv = &debData.Queue[head & (BSP_DEBOUNCE_QUEUE - 1)];
+    pEv->Time = now;
+    pEv->Input = input;
+    pEv->Type = type;
+    __DMB();
+    debData.Head = head + 1;
+}
+
+void bspDebounceInit(void)
+{
+    debData.Div = 0;
+
+#if BSP_DEBOUNCE_BUTTON == BSP_ENABLED
+
+    /* The button of the nucleo board is active low */
+    bspDebounceAdd(BSP_DEBOUNCE_BUTTON_ID, BSP_GPIO_BUTTON, true);
+
+#endif /* BSP_DEBOUNCE_BUTTON == BSP_ENABLED */
+}
+
+bspStatus_t bspDebounceAdd(uint32_t input, bspGpioPin_t pin, bool activeLow)
+{
+    uint32_t mask = BSP_IOMAPPIN(pin);
+
+    if (input >= BSP_DEBOUNCE_NUM || mask == 0 || (mask & (mask - 1)) != 0)
+        return BSP_EEINVAL;
+
+    if (debData.In[input].Used)
+        return BSP_EBUSY;
+
+    debData.In[input].pPort = BSP_IOMAPPORT(pin);
+    debData.In[input].Mask = mask;
+    debData.In[input].ActiveLow = activeLow;
+    debData.In[input].Hist = 0;
+    debData.In[input].Active = false;
+    debData.In[input].Long = false;
+
+    /* Enables sampling, hence the tick only reads the input if set */
+    __DMB();
+    debData.In[input].Used = true;
+
+    return BSP_OK;
+}
+
+void bspDebounceRemove(uint32_t input)
+{
+    if (input < BSP_DEBOUNCE_NUM)
+        debData.In[input].Used = false;
+}
+
+bool bspDebounceIsActive(uint32_t input)
+{
+    if (input >= BSP_DEBOUNCE_NUM)
+        return false;
+
+    return debData.In[input].Used && debData.In[input].Active;
+}
+
+bspStatus_t bspDebounceGetEvent(bspDebounceEvent_t *pEv)
+{
+    uint32_t tail = debData.Tail;
+
+    if (tail == debData.Head)
+        return BSP_EEMPTY;
+
+    __DMB();
+    *pEv = debData.Queue[tail & (BSP_DEBOUNCE_QUEUE - 1)];
+    __DMB();
+    debData.Tail = tail + 1;
+
+    return BSP_OK;
+}
+
+uint32_t bspDebounceGetLost(void)
+{
+    return debData.Lost;
+}
+
+void bspDebounceTick(void)
+{
+    uint32_t now;
+
+    if (++debData.Div < BSP_DEBOUNCE_TICK_MS)
+        return;
+
+    debData.Div = 0;
+    now = bspGetSysTick();
+
+    for (uint32_t i = 0; i < BSP_DEBOUNCE_NUM; i++)
+    {
+        bool raw;
+
+        if (!debData.In[i].Used)
+            continue;
+
+        raw = (READ_REG(debData.In[i].pPort->IDR) & debData.In[i].Mask) != 0;
+        raw = raw != debData.In[i].ActiveLow;
+        debData.In[i].Hist = (debData.In[i].Hist << 1) | (raw ? 1 : 0);
+
+        if (!debData.In[i].Active)
+        {
+            if ((debData.In[i].Hist & DEB_HIST_MASK) == DEB_HIST_MASK)
+            {
+                debData.In[i].Active = true;
+                debData.In[i].Long = false;
+                debData.In[i].Since = now;
+                debouncePut(i, BSP_DEBOUNCE_PRESS, now);
+            }
+        }
+        else if ((debData.In[i].Hist & DEB_HIST_MASK) == 0)
+        {
+            debData.In[i].Active = false;
+            debouncePut(i, BSP_DEBOUNCE_RELEASE, now);
+        }
+        else if (!debData.In[i].Long)
+        {
+            if (now - debData.In[i].Since >= BSP_DEBOUNCE_LONG_MS)
+            {
+                debData.In[i].Long = true;
+                debData.In[i].Next = BSP_DEBOUNCE_LONG_MS + 
+                    BSP_DEBOUNCE_REPEAT_MS;
+                debouncePut(i, BSP_DEBOUNCE_LONG, now);
+            }
+        }
+        else if (BSP_DEBOUNCE_REPEAT_MS != 0)
+        {
+            if (now - debData.In[i].Since >= debData.In[i].Next)
+            {
+                debData.In[i].Next += BSP_DEBOUNCE_REPEAT_MS;
+                debouncePut(i, BSP_DEBOUNCE_REPEAT, now);
+            }
+        }
+    }
+}
+
+#endif /* BSP_DEBOUNCE == BSP_ENABLED */
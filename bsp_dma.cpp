@@ -0,0 +1,475 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+
+#include <stm32f4xx_ll_dma.h>
+
+#include "bsp/bsp.h"
+#include "bsp/bsp_assert.h"
+#include "bsp/bsp_dma.h"
+#include "bsp/bsp_isr.h"
+#include "bsp/bsp_wave.h"
+#include "bsp/bsp_capture.h"
+#include "bsp/bsp_icap.h"
+
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * @brief The requests used by the enabled bsp modules and the application,
+ * terminated by BSP_DMA_REQ_CNT.
+ */
+static constexpr bspDmaReq_t dmaReqs[] =
+{
+#if BSP_TTY_TX_DMA == BSP_ENABLED
+
+    TTY_TXDMA_REQ,
+
+#endif /* BSP_TTY_TX_DMA == BSP_ENABLED */
+
+#if BSP_WAVE == BSP_ENABLED
+
+    BSP_WAVE_DMA_REQ,
+
+#endif /* BSP_WAVE == BSP_ENABLED */
+
+#if BSP_CAPTURE == BSP_ENABLED
+
+    BSP_CAPTURE_DMA_REQ,
+
+#endif /* BSP_CAPTURE == BSP_ENABLED */
+
+#if BSP_ICAP == BSP_ENABLED
+
+    BSP_ICAP_RISE_REQ,
+    BSP_ICAP_FALL_REQ,
+
+#endif /* BSP_ICAP == BSP_ENABLED */
+
+#if BSP_DMA_M2M == BSP_ENABLED
+
+    BSP_DMA_M2M_REQ,
+
+#endif /* BSP_DMA_M2M == BSP_ENABLED */
+
+#ifdef BSP_DMA_USER_REQS
+
+    BSP_DMA_USER_REQS
+
+#endif /* BSP_DMA_USER_REQS */
+
+    BSP_DMA_REQ_CNT
+};
+
+static_assert(bspDmaUnique(dmaReqs, sizeof(dmaReqs) / sizeof(dmaReqs[0]) - 1),
+    "Two enabled DMA requests share the same stream");
+
+/**
+ * @brief The owners of all streams.
+ */
+static struct
+{
+    struct
+    {
+        bspDmaIsr_t Isr;
+        void *pCtx;
+        bool Claimed;
+
+    } Stream[2][8];
+
+} dmaData;
+
+/**
+ * @brief Reads and clears the flags of a stream and calls its handler.
+ */
+__attribute__((always_inline)) static inline void dmaDispatch(
+    DMA_TypeDef *pDma, uint32_t idx, uint32_t stream)
+{
+    uint32_t pos = bspDmaFlagPos(stream);
+    uint32_t flags = 0;
+
+    if (stream < 4)
+    {
+        flags = (pDma->LISR >> pos) & BSP_DMA_FLAG_ALL;
+        WRITE_REG(pDma->LIFCR, flags << pos);
+    }
+    else
+    {
+        flags = (pDma->HISR >> pos) & BSP_DMA_FLAG_ALL;
+        WRITE_REG(pDma->HIFCR, flags << pos);
+    }
+
+    if (dmaData.Stream[idx][stream].Isr != NULL)
+        dmaData.Stream[idx][stream].Isr(flags, dmaData.Stream[idx][stream].pCtx);
+}
+
+/**
+ * @brief Implements the interrupt handler of a stream. 
+ * 
+ * Hence that they are weak, so the application can still implement a stream
+ * interrupt on its own.
+ */
+#define DMA_IRQ_HANDLER(_dma, _stream)                                      \
+                                                                            \
+    extern "C" __attribute__((weak)) BSP_RAMFUNC_ISR                        \
+    void DMA##_dma##_Stream##_stream##_IRQHandler(void)                     \
+    {                                                                       \
+        dmaDispatch(DMA##_dma, _dma - 1, _stream);                          \
+    }
+
+DMA_IRQ_HANDLER(1, 0)
+DMA_IRQ_HANDLER(1, 1)
+DMA_IRQ_HANDLER(1, 2)
+DMA_IRQ_HANDLER(1, 3)
+DMA_IRQ_HANDLER(1, 4)
+DMA_IRQ_HANDLER(1, 5)
+DMA_IRQ_HANDLER(1, 6)
+DMA_IRQ_HANDLER(1, 7)
+DMA_IRQ_HANDLER(2, 0)
+DMA_IRQ_HANDLER(2, 1)
+DMA_IRQ_HANDLER(2, 2)
+DMA_IRQ_HANDLER(2, 3)
+DMA_IRQ_HANDLER(2, 4)
+DMA_IRQ_HANDLER(2, 5)
+DMA_IRQ_HANDLER(2, 6)
+DMA_IRQ_HANDLER(2, 7)
+
+bspStatus_t bspDmaClaim(bspDmaReq_t req, bspDmaIsr_t isr, void *pCtx, 
+    uint32_t prio)
+{
+    uint32_t crit = 0;
+    uint32_t idx = 0;
+    uint32_t stream = 0;
+
+    if (req >= BSP_DMA_REQ_CNT)
+        return BSP_EEINVAL;
+
+    idx = bspDmaMap[req].Dma - 1;
+    stream = bspDmaMap[req].Stream;
+
+    crit = bspCriticalEnter();
+
+    if (dmaData.Stream[idx][stream].Claimed)
+    {
+        bspCriticalExit(crit);
+        return BSP_EBUSY;
+    }
+
+    dmaData.Stream[idx][stream].Claimed = true;
+    dmaData.Stream[idx][stream].Isr = isr;
+    dmaData.Stream[idx][stream].pCtx = pCtx;
+
+    bspCriticalExit(crit);
+
+    if (isr != NULL)
+    {
+        bspIrqEnable(bspDmaGetIrq(req), prio);
+    }
+
+    return BSP_OK;
+}
+
+void bspDmaRelease(bspDmaReq_t req)
+{
+    uint32_t idx = 0;
+    uint32_t stream = 0;
+
+    if (req >= BSP_DMA_REQ_CNT)
+        return;
+
+    idx = bspDmaMap[req].Dma - 1;
+    stream = bspDmaMap[req].Stream;
+
+    NVIC_DisableIRQ(bspDmaGetIrq(req));
+    bspDmaStop(req);
+
+    dmaData.Stream[idx][stream].Isr = NULL;
+    dmaData.Stream[idx][stream].pCtx = NULL;
+    dmaData.Stream[idx][stream].Claimed = false;
+}
+
+bool bspDmaIsClaimed(bspDmaReq_t req)
+{
+    if (req >= BSP_DMA_REQ_CNT)
+        return false;
+
+    return dmaData.Stream[bspDmaMap[req].Dma - 1][bspDmaMap[req].Stream].Claimed;
+}
+
+void bspDmaStop(bspDmaReq_t req)
+{
+    DMA_TypeDef *pDma = bspDmaGetDma(req);
+    uint32_t stream = bspDmaGetStream(req);
+
+    LL_DMA_DisableStream(pDma, stream);
+    while (LL_DMA_IsEnabledStream(pDma, stream));
+
+    /* Disabling the stream sets the transfer complete flag */
+    bspDmaClearFlags(req, BSP_DMA_FLAG_ALL);
+    NVIC_ClearPendingIRQ(bspDmaGetIrq(req));
+}
+
+#if BSP_DMA_M2M == BSP_ENABLED
+
+#if (BSP_DMA_M2M_QUEUE & (BSP_DMA_M2M_QUEUE - 1)) != 0
+#error BSP_DMA_M2M_QUEUE has to be a power of two
+#endif
+
+static_assert(bspDmaMap[BSP_DMA_M2M_REQ].Dma == 2, 
+    "Memory to memory transfers are only supported by DMA2");
+
+/**
+ * @brief The memory to memory stream, see BSP_DMA_M2M_REQ.
+ */
+#define M2M_DMA                             bspDmaGetDma(BSP_DMA_M2M_REQ)
+#define M2M_DMA_STR                         bspDmaGetStream(BSP_DMA_M2M_REQ)
+#define M2M_DMA_CH                          bspDmaGetChannel(BSP_DMA_M2M_REQ)
+
+/**
+ * @brief The largest chunk in bytes of a single stream transfer of items 
+ * of the given width, a multiple of the burst size.
+ */
+#define M2M_CHUNK(_width)                   ((0xFFFFUL * (_width)) & ~15UL)
+
+/**
+ * @brief A queued transfer.
+ */
+typedef struct
+{
+    uint8_t *pDst;
+    const uint8_t *pSrc;
+    uint32_t Len;
+    uint32_t Fill;
+    bool Set;
+    bspDmaM2MCb_t Cb;
+    void *pCtx;
+
+} m2mXfer_t;
+
+/**
+ * @brief Transfer queue shared with the interrupt, Tail is the transfer in 
+ * progress. Both counters also serve as transfer IDs.
+ */
+static struct
+{
+    m2mXfer_t Queue[BSP_DMA_M2M_QUEUE];
+    volatile uint32_t Head;
+    volatile uint32_t Tail;
+    uint32_t Pos;
+    uint32_t Chunk;
+
+} m2mData;
+
+/**
+ * @brief Starts the next chunk of the transfer at the tail of the queue.
+ */
+static void m2mStart(void)
+{
+    m2mXfer_t *pXfer = &m2mData.Queue[m2mData.Tail & (BSP_DMA_M2M_QUEUE - 1)];
+    uint32_t dst = (uint32_t) pXfer->pDst + m2mData.Pos;
+    uint32_t src = pXfer->Set ? 
+        (uint32_t) &pXfer->Fill : (uint32_t) pXfer->pSrc + m2mData.Pos;
+    uint32_t len = pXfer->Len - m2mData.Pos;
+    uint32_t align = pXfer->Set ? dst : dst | src;
+    uint32_t width = 4;
+    uint32_t unit, psize, msize;
+    LL_DMA_InitTypeDef dma;
+
+    /* The widest access the alignment of both buffers allows, the rest at 
+     * the end is done by a further chunk */
+    while ((align & (width - 1)) != 0 || len < width)
+        width /= 2;
+
+    /* Bursts must not cross a 1k boundary, which is given by the alignment */
+    unit = (width == 4 && (align & 15) == 0 && len >= 16) ? 16 : width;
+
+    m2mData.Chunk = len < M2M_CHUNK(width) ? len : M2M_CHUNK(width);
+    m2mData.Chunk -= m2mData.Chunk % unit;
+
+    psize = width == 4 ? LL_DMA_PDATAALIGN_WORD : 
+        width == 2 ? LL_DMA_PDATAALIGN_HALFWORD : LL_DMA_PDATAALIGN_BYTE;
+    msize = width == 4 ? LL_DMA_MDATAALIGN_WORD : 
+        width == 2 ? LL_DMA_MDATAALIGN_HALFWORD : LL_DMA_MDATAALIGN_BYTE;
+
+    LL_DMA_StructInit(&dma);
+    dma.Channel = M2M_DMA_CH;
+    dma.Mode = LL_DMA_MODE_NORMAL;
+    dma.Direction = LL_DMA_DIRECTION_MEMORY_TO_MEMORY;
+    dma.Priority = LL_DMA_PRIORITY_LOW;
+    dma.PeriphOrM2MSrcIncMode = pXfer->Set ? 
+        LL_DMA_PERIPH_NOINCREMENT : LL_DMA_PERIPH_INCREMENT;
+    dma.MemoryOrM2MDstIncMode = LL_DMA_MEMORY_INCREMENT;
+    dma.PeriphOrM2MSrcDataSize = psize;
+    dma.MemoryOrM2MDstDataSize = msize;
+    dma.FIFOMode = LL_DMA_FIFOMODE_ENABLE;
+    dma.FIFOThreshold = LL_DMA_FIFOTHRESHOLD_FULL;
+    dma.MemBurst = unit == 16 ? LL_DMA_MBURST_INC4 : LL_DMA_MBURST_SINGLE;
+    dma.PeriphBurst = unit == 16 && !pXfer->Set ? 
+        LL_DMA_PBURST_INC4 : LL_DMA_PBURST_SINGLE;
+    dma.PeriphOrM2MSrcAddress = src;
+    dma.MemoryOrM2MDstAddress = dst;
+    dma.NbData = m2mData.Chunk / width;
+    LL_DMA_Init(M2M_DMA, M2M_DMA_STR, &dma);
+
+    LL_DMA_EnableIT_TC(M2M_DMA, M2M_DMA_STR);
+    LL_DMA_EnableIT_TE(M2M_DMA, M2M_DMA_STR);
+    LL_DMA_EnableStream(M2M_DMA, M2M_DMA_STR);
+}
+
+/**
+ * @brief Memory to memory DMA interrupt handler, called by the stream 
+ * interrupt.
+ */
+static void m2mDmaIsr(uint32_t flags, void *pCtx)
+{
+    BSP_ISR_ENTER(BSP_ISR_DMA_M2M);
+
+    m2mXfer_t *pXfer = &m2mData.Queue[m2mData.Tail & (BSP_DMA_M2M_QUEUE - 1)];
+    bspDmaM2MCb_t cb = pXfer->Cb;
+
+    if (flags & (BSP_DMA_FLAG_TE | BSP_DMA_FLAG_TC))
+    {
+        if (flags & BSP_DMA_FLAG_TE)
+        {
+            /* Most likely a buffer in a region the DMA can not access, drop
+             * the transfer */
+            bspDoAssert();
+            m2mData.Pos = pXfer->Len;
+        }
+        else
+        {
+            m2mData.Pos += m2mData.Chunk;
+        }
+
+        if (m2mData.Pos < pXfer->Len)
+        {
+            m2mStart();
+        }
+        else
+        {
+            pCtx = pXfer->pCtx;
+            m2mData.Pos = 0;
+            m2mData.Tail++;
+
+            if (m2mData.Tail != m2mData.Head)
+                m2mStart();
+
+            if (cb != NULL)
+                cb(pCtx);
+        }
+    }
+
+    BSP_ISR_EXIT(BSP_ISR_DMA_M2M);
+}
+
+/**
+ * @brief Queues the given transfer or does it right away if it is small and
+ * nothing else is queued.
+ */
+static bspStatus_t m2mQueue(const m2mXfer_t *pXfer, uint32_t *pId)
+{
+    uint32_t crit = bspCriticalEnter();
+    uint32_t id = 0;
+    bool cpu = false;
+
+    if (m2mData.Head - m2mData.Tail >= BSP_DMA_M2M_QUEUE)
+    {
+        bspCriticalExit(crit);
+        return BSP_EBUSY;
+    }
+
+    if (m2mData.Head == m2mData.Tail && pXfer->Len < BSP_DMA_M2M_MIN)
+    {
+        /* Reported as done, like the last transfer */
+        id = m2mData.Tail - 1;
+        cpu = true;
+
+        if (pXfer->Set)
+            memset(pXfer->pDst, (int) (pXfer->Fill & 0xFF), pXfer->Len);
+        else
+            memcpy(pXfer->pDst, pXfer->pSrc, pXfer->Len);
+    }
+    else
+    {
+        id = m2mData.Head;
+        m2mData.Queue[id & (BSP_DMA_M2M_QUEUE - 1)] = *pXfer;
+        m2mData.Head = id + 1;
+
+        if (id == m2mData.Tail)
+            m2mStart();
+    }
+
+    bspCriticalExit(crit);
+
+    if (pId != NULL)
+        *pId = id;
+
+    if (cpu && pXfer->Cb != NULL)
+        pXfer->Cb(pXfer->pCtx);
+
+    return BSP_OK;
+}
+
+void bspDmaM2MInit(void)
+{
+    m2mData.Head = 0;
+    m2mData.Tail = 0;
+    m2mData.Pos = 0;
+
+    bspDmaClaim(BSP_DMA_M2M_REQ, m2mDmaIsr, NULL, BSP_IRQPRIO_DMA_M2M);
+}
+
+bspStatus_t bspDmaMemcpyAsync(void *pDst, const void *pSrc, uint32_t len, 
+    bspDmaM2MCb_t cb, void *pCtx, uint32_t *pId)
+{
+    m2mXfer_t xfer = {(uint8_t *) pDst, (const uint8_t *) pSrc, len, 0, 
+        false, cb, pCtx};
+
+    if (pDst == NULL || pSrc == NULL || len == 0)
+        return BSP_EEINVAL;
+
+    return m2mQueue(&xfer, pId);
+}
+
+bspStatus_t bspDmaMemsetAsync(void *pDst, uint8_t val, uint32_t len, 
+    bspDmaM2MCb_t cb, void *pCtx, uint32_t *pId)
+{
+    m2mXfer_t xfer = {(uint8_t *) pDst, NULL, len, val * 0x01010101UL, 
+        true, cb, pCtx};
+
+    if (pDst == NULL || len == 0)
+        return BSP_EEINVAL;
+
+    return m2mQueue(&xfer, pId);
+}
+
+bool bspDmaM2MIsDone(uint32_t id)
+{
+    return (int32_t)(m2mData.Tail - id) > 0;
+}
+
+bool bspDmaM2MIsIdle(void)
+{
+    return m2mData.Head == m2mData.Tail;
+}
+
+#endif /* BSP_DMA_M2M == BSP_ENABLED */
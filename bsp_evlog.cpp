@@ -0,0 +1,169 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+
+#include <stm32f4xx_ll_rcc.h>
+
+#include "bsp/bsp.h"
+#include "bsp/bsp_bkpsram.h"
+#include "bsp/bsp_evlog.h"
+
+#include <stdio.h>
+
+#if BSP_EVLOG == BSP_ENABLED
+
+#if (BSP_EVLOG_SIZE & (BSP_EVLOG_SIZE - 1)) != 0
+#error BSP_EVLOG_SIZE has to be a power of two
+#endif
+
+/**
+ * @brief Marks a valid log, "EVLG".
+ */
+#define EVLOG_MAGIC                         0x474C5645UL
+
+/**
+ * @brief The time stamp source, see bspEvLog().
+ */
+#if BSP_EVLOG_CYCLES == BSP_ENABLED || BSP_SYSTICK != BSP_ENABLED
+#define EVLOG_TIME()                        bspGetCycleCount()
+#else
+#define EVLOG_TIME()                        bspGetSysTick()
+#endif
+
+/**
+ * @brief The log in the backup SRAM.
+ */
+typedef struct
+{
+    uint32_t Magic;
+    uint32_t Size;
+    volatile uint32_t Head;
+    uint32_t Reserved;
+
+    struct
+    {
+        uint32_t Time;
+        uint32_t Arg;
+        volatile uint32_t IdSeq;    ///<! ID in the upper, seq in the lower half
+
+    } Entry[BSP_EVLOG_SIZE];
+
+} evLog_t;
+
+static_assert(sizeof(evLog_t) == BSP_BKPSRAM_EVLOG_SIZE,
+    "The event log does not match its backup SRAM region");
+
+static_assert(BSP_BKPSRAM_APP_OFS <= BSP_BKPSRAM_SIZE,
+    "BSP_EVLOG_SIZE too large for the backup SRAM");
+
+/**
+ * @brief The log in the backup SRAM.
+ */
+#define EVLOG                               ((evLog_t *) \
+                                            bspBkpSramAddr(BSP_BKPSRAM_EVLOG_OFS))
+
+void bspEvLogInit(void)
+{
+    bspBkpSramInit();
+
+    if (EVLOG->Magic != EVLOG_MAGIC || EVLOG->Size != BSP_EVLOG_SIZE)
+        bspEvLogClear();
+
+    /* Separates the runs in the log */
+    bspEvLog(BSP_EVLOG_ID_BOOT, RCC->CSR);
+
+#if BSP_CRASH != BSP_ENABLED
+
+    /* Otherwise done by bspCrashInit(), the flags would accumulate over all
+     * resets until the next power cycle */
+    LL_RCC_ClearResetFlags();
+
+#endif /* BSP_CRASH != BSP_ENABLED */
+}
+
+void bspEvLog(uint16_t id, uint32_t arg)
+{
+    evLog_t *pLog = EVLOG;
+    uint32_t time = EVLOG_TIME();
+    uint32_t pos = 0;
+    uint32_t idx = 0;
+
+    do
+    {
+        pos = __LDREXW(&pLog->Head);
+    } while (__STREXW(pos + 1, &pLog->Head) != 0);
+
+    idx = pos & (BSP_EVLOG_SIZE - 1);
+    pLog->Entry[idx].Time = time;
+    pLog->Entry[idx].Arg = arg;
+
+    /* Validates the entry, so it has to be written last */
+    __DMB();
+    pLog->Entry[idx].IdSeq = ((uint32_t) id << 16) | (pos & 0xFFFF);
+}
+
+void bspEvLogDump(void)
+{
+    evLog_t *pLog = EVLOG;
+    uint32_t head = pLog->Head;
+    uint32_t pos = head > BSP_EVLOG_SIZE ? head - BSP_EVLOG_SIZE : 0;
+    uint32_t time, arg, idSeq, idx;
+
+    printf("#evlog %lu\n", (unsigned long)(head - pos));
+
+    for (; pos != head; pos++)
+    {
+        idx = pos & (BSP_EVLOG_SIZE - 1);
+        time = pLog->Entry[idx].Time;
+        arg = pLog->Entry[idx].Arg;
+        idSeq = pLog->Entry[idx].IdSeq;
+
+        /* Torn by a reset or already overwritten by a newer entry */
+        if ((idSeq & 0xFFFF) != (pos & 0xFFFF))
+            continue;
+
+        printf("%10lu %04lx %08lx\n", (unsigned long) time,
+            (unsigned long)(idSeq >> 16), (unsigned long) arg);
+    }
+
+    printf("#end\n");
+}
+
+void bspEvLogClear(void)
+{
+    evLog_t *pLog = EVLOG;
+    uint32_t crit = bspCriticalEnter();
+
+    pLog->Magic = 0;
+    pLog->Size = BSP_EVLOG_SIZE;
+    pLog->Head = 0;
+
+    /* A sequence number which never matches a valid position */
+    for (uint32_t idx = 0; idx < BSP_EVLOG_SIZE; idx++)
+        pLog->Entry[idx].IdSeq = 0xFFFFFFFFUL;
+
+    pLog->Magic = EVLOG_MAGIC;
+
+    bspCriticalExit(crit);
+}
+
+#endif /* BSP_EVLOG == BSP_ENABLED */
@@ -3,19 +3,19 @@
  * projects.
  *
  * Copyright (C) 2020 Julian Friedrich
- * 
+ *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
  * the Free Software Foundation, either version 3 of the License, or
  * (at your option) any later version.
- * 
+ *
  * This program is distributed in the hope that it will be useful,
  * but WITHOUT ANY WARRANTY; without even the implied warranty of
  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
  * GNU General Public License for more details.
- * 
+ *
  * You should have received a copy of the GNU General Public License
- * along with this program.  If not, see <https://www.gnu.org/licenses/>. 
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  *
  * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
  */
@@ -23,14 +23,85 @@
 #include "bsp/bsp.h"
 #include "bsp/bsp_exti.h"
 #include "bsp/bsp_assert.h"
+#include "bsp/bsp_isr.h"
+#include "generic/generic.hpp"
 
 #include <stm32f4xx_ll_exti.h>
 
+#include <string.h>
+
+/**
+ * @brief Number of external interrupt lines connected to gpio pins.
+ */
+#define BSP_EXTI_NUMLINES                    16
+
+/**
+ * @brief The lines served by the shared vectors.
+ */
+#define BSP_EXTI_LINES_9_5                   0x000003E0UL
+#define BSP_EXTI_LINES_15_10                 0x0000FC00UL
+
 /**
  * @brief Waek declaration of the users button irq callback.
  */
 void bspButtonIrqCb(void) __attribute__((weak, alias("bspDefaultExtiCb")));
 
+#if BSP_EXTI_CAPTURE == BSP_ENABLED
+
+#if (BSP_EXTI_CAPTURE_SIZE & (BSP_EXTI_CAPTURE_SIZE - 1)) != 0
+#error BSP_EXTI_CAPTURE_SIZE has to be a power of two
+#endif
+
+/**
+ * @brief Takes the time stamp at the entry of the isr's.
+ */
+#define EXTI_TIMESTAMP()                     bspGetCycleCount()
+
+/**
+ * @brief Single producer single consumer ring buffer of captured events.
+ */
+typedef struct
+{
+   bspExtiEvent_t Ev[BSP_EXTI_CAPTURE_SIZE];
+   volatile uint32_t Head;
+   volatile uint32_t Tail;
+   uint32_t Lost;
+   GPIO_TypeDef *pPort;
+   uint32_t Mask;
+   bool Used;
+
+} extiRing_t;
+
+/**
+ * @brief The ring buffers, assigned to lines by bspExtiAttachCapture().
+ */
+static extiRing_t extiRings[BSP_EXTI_CAPTURE_NUM];
+
+#else /* BSP_EXTI_CAPTURE == BSP_ENABLED */
+
+/**
+ * @brief No time stamps needed as capturing is disabled.
+ */
+#define EXTI_TIMESTAMP()                     0
+
+/**
+ * @brief Capturing is disabled.
+ */
+typedef void extiRing_t;
+
+#endif /* BSP_EXTI_CAPTURE == BSP_ENABLED */
+
+/**
+ * @brief The callbacks of all lines.
+ */
+static struct
+{
+   bspExtiCb_t Cb;
+   void *pCtx;
+   extiRing_t *pRing;
+
+} extiTable[BSP_EXTI_NUMLINES];
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -47,41 +118,453 @@ void bspDefaultExtiCb(void)
    bspDoAssert();
 }
 
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @brief Records the given time stamp, if the line is in capture mode, and 
+ * calls its callback.
+ */
+static inline void extiCall(uint32_t line, uint32_t now)
+{
+#if BSP_EXTI_CAPTURE == BSP_ENABLED
+
+   extiRing_t *pRing = extiTable[line].pRing;
+
+   if (pRing != 0)
+   {
+      uint32_t level = (READ_REG(pRing->pPort->IDR) & pRing->Mask) ? 1 : 0;
+      uint32_t head = pRing->Head;
+
+      if (head - pRing->Tail < BSP_EXTI_CAPTURE_SIZE)
+      {
+         pRing->Ev[head & (BSP_EXTI_CAPTURE_SIZE - 1)].Time = now;
+         pRing->Ev[head & (BSP_EXTI_CAPTURE_SIZE - 1)].Level = level;
+         __DMB();
+         pRing->Head = head + 1;
+      }
+      else
+      {
+         pRing->Lost++;
+      }
+   }
+
+#else /* BSP_EXTI_CAPTURE == BSP_ENABLED */
+
+   unused(now);
+
+#endif /* BSP_EXTI_CAPTURE == BSP_ENABLED */
+
+   /* Might have been detached by a previous callback */
+   if (extiTable[line].Cb != 0)
+      extiTable[line].Cb(extiTable[line].pCtx);
+}
+
+/**
+ * @brief Serves all pending lines out of the given ones.
+ * 
+ * Only attached lines are unmasked, so every pending line has a callback or
+ * a ring buffer.
+ */
+static inline void extiDispatch(uint32_t lines, uint32_t now)
+{
+   uint32_t pending = READ_REG(EXTI->PR) & READ_REG(EXTI->IMR) & lines;
+
+   while (pending != 0)
+   {
+      uint32_t line = 31 - __CLZ(pending);
+
+      pending &= ~(1UL << line);
+      WRITE_REG(EXTI->PR, 1UL << line);
+      extiCall(line, now);
+   }
+}
+
+/**
+ * @brief Serves a line with its own vector.
+ */
+static inline void extiDispatchLine(uint32_t line, uint32_t now)
+{
+   WRITE_REG(EXTI->PR, 1UL << line);
+   extiCall(line, now);
+}
+
+/**
+ * @brief Interrupt vector of the given line.
+ */
+static inline IRQn_Type extiIrq(uint32_t line)
+{
+   if (line < 5)
+      return (IRQn_Type)(EXTI0_IRQn + line);
+
+   if (line < 10)
+      return EXTI9_5_IRQn;
+
+   return EXTI15_10_IRQn;
+}
+
+/**
+ * @brief All lines sharing the vector of the given line.
+ */
+static inline uint32_t extiIrqLines(uint32_t line)
+{
+   if (line < 5)
+      return 1UL << line;
+
+   if (line < 10)
+      return BSP_EXTI_LINES_9_5;
+
+   return BSP_EXTI_LINES_15_10;
+}
+
+extern "C" void EXTI0_IRQHandler(void)
+{
+   uint32_t now = EXTI_TIMESTAMP();
+
+   BSP_ISR_ENTER(BSP_ISR_EXTI0);
+   extiDispatchLine(0, now);
+   BSP_ISR_EXIT(BSP_ISR_EXTI0);
+}
+
+extern "C" void EXTI1_IRQHandler(void)
+{
+   uint32_t now = EXTI_TIMESTAMP();
+
+   BSP_ISR_ENTER(BSP_ISR_EXTI1);
+   extiDispatchLine(1, now);
+   BSP_ISR_EXIT(BSP_ISR_EXTI1);
+}
+
+extern "C" void EXTI2_IRQHandler(void)
+{
+   uint32_t now = EXTI_TIMESTAMP();
+
+   BSP_ISR_ENTER(BSP_ISR_EXTI2);
+   extiDispatchLine(2, now);
+   BSP_ISR_EXIT(BSP_ISR_EXTI2);
+}
+
+extern "C" void EXTI3_IRQHandler(void)
+{
+   uint32_t now = EXTI_TIMESTAMP();
+
+   BSP_ISR_ENTER(BSP_ISR_EXTI3);
+   extiDispatchLine(3, now);
+   BSP_ISR_EXIT(BSP_ISR_EXTI3);
+}
+
+extern "C" void EXTI4_IRQHandler(void)
+{
+   uint32_t now = EXTI_TIMESTAMP();
+
+   BSP_ISR_ENTER(BSP_ISR_EXTI4);
+   extiDispatchLine(4, now);
+   BSP_ISR_EXIT(BSP_ISR_EXTI4);
+}
+
+extern "C" void EXTI9_5_IRQHandler(void)
+{
+   uint32_t now = EXTI_TIMESTAMP();
+
+   BSP_ISR_ENTER(BSP_ISR_EXTI9_5);
+   extiDispatch(BSP_EXTI_LINES_9_5, now);
+   BSP_ISR_EXIT(BSP_ISR_EXTI9_5);
+}
+
+extern "C" BSP_RAMFUNC_ISR void EXTI15_10_IRQHandler(void)
+{
+   uint32_t now = EXTI_TIMESTAMP();
+
+   BSP_ISR_ENTER(BSP_ISR_EXTI15_10);
+   extiDispatch(BSP_EXTI_LINES_15_10, now);
+   BSP_ISR_EXIT(BSP_ISR_EXTI15_10);
+}
+
+#if BSP_DEBOUNCE != BSP_ENABLED || BSP_DEBOUNCE_BUTTON != BSP_ENABLED
+
 /**
- * @brief Common interrupt handler for all external interrupts.
+ * @brief Adapter for the users button callback.
+ */
+static void extiButtonCb(void *pCtx)
+{
+   bspButtonIrqCb();
+}
+
+#endif
+
+/**
+ * @brief Derives the line number from the given pin ID.
  * 
+ * @return  The line number or -1 if the ID does not refer to a single pin.
  */
-void EXTI15_10_IRQHandler(void)
+static inline int32_t extiLine(bspGpioPin_t pin)
 {
-   if(LL_EXTI_IsActiveFlag_0_31(BSP_BUTTON_EXTI_LINE) != RESET)
+   uint32_t mask = BSP_IOMAPPIN(pin);
+
+   if (mask == 0 || (mask & (mask - 1)) != 0)
+      return -1;
+
+   return 31 - __CLZ(mask);
+}
+
+/**
+ * @brief Common part of bspExtiAttach() and bspExtiAttachCapture().
+ */
+static bspStatus_t extiAttach(bspGpioPin_t pin, bspExtiEdge_t edge, 
+      bspExtiCb_t cb, void *pCtx, extiRing_t *pRing)
+{
+   int32_t line = extiLine(pin);
+   uint32_t mask, pos, crit;
+
+   if (line < 0 || (cb == 0 && pRing == 0))
+      return BSP_EEINVAL;
+
+   if ((edge & BSP_EXTI_BOTH) == 0)
+      return BSP_EEINVAL;
+
+   mask = 1UL << line;
+   pos = (line & 3) * 4;
+
+   crit = bspCriticalEnter();
+
+   if (extiTable[line].Cb != 0 || extiTable[line].pRing != 0)
    {
-      LL_EXTI_ClearFlag_0_31(BSP_BUTTON_EXTI_LINE);
-      bspButtonIrqCb();
+      bspCriticalExit(crit);
+      return BSP_EBUSY;
    }
+
+   extiTable[line].Cb = cb;
+   extiTable[line].pCtx = pCtx;
+   extiTable[line].pRing = pRing;
+
+   MODIFY_REG(SYSCFG->EXTICR[line >> 2], 0xFUL << pos, 
+         BSP_IOMAPIDX(pin) << pos);
+
+   if (edge & BSP_EXTI_RISING)
+      SET_BIT(EXTI->RTSR, mask);
    else
+      CLEAR_BIT(EXTI->RTSR, mask);
+
+   if (edge & BSP_EXTI_FALLING)
+      SET_BIT(EXTI->FTSR, mask);
+   else
+      CLEAR_BIT(EXTI->FTSR, mask);
+
+   WRITE_REG(EXTI->PR, mask);
+   SET_BIT(EXTI->IMR, mask);
+
+   bspCriticalExit(crit);
+
+   bspIrqEnable(extiIrq(line), BSP_IRQPRIO_EXTI);
+
+   return BSP_OK;
+}
+
+bspStatus_t bspExtiAttach(bspGpioPin_t pin, bspExtiEdge_t edge, 
+      bspExtiCb_t cb, void *pCtx)
+{
+   if (cb == 0)
+      return BSP_EEINVAL;
+
+   return extiAttach(pin, edge, cb, pCtx, 0);
+}
+
+void bspExtiDetach(bspGpioPin_t pin)
+{
+   int32_t line = extiLine(pin);
+   uint32_t mask, crit;
+
+   if (line < 0)
+      return;
+
+   mask = 1UL << line;
+
+   crit = bspCriticalEnter();
+
+   CLEAR_BIT(EXTI->IMR, mask);
+   CLEAR_BIT(EXTI->RTSR, mask);
+   CLEAR_BIT(EXTI->FTSR, mask);
+   WRITE_REG(EXTI->PR, mask);
+
+#if BSP_EXTI_CAPTURE == BSP_ENABLED
+
+   if (extiTable[line].pRing != 0)
+      extiTable[line].pRing->Used = false;
+
+#endif /* BSP_EXTI_CAPTURE == BSP_ENABLED */
+
+   extiTable[line].Cb = 0;
+   extiTable[line].pCtx = 0;
+   extiTable[line].pRing = 0;
+
+   /* Shared vectors stay enabled as long as one of their lines is used */
+   if ((READ_REG(EXTI->IMR) & extiIrqLines(line)) == 0)
    {
-      bspDoAssert();
+      NVIC_DisableIRQ(extiIrq(line));
+      NVIC_ClearPendingIRQ(extiIrq(line));
    }
+
+   bspCriticalExit(crit);
 }
 
-#ifdef __cplusplus
+#if BSP_EXTI_CAPTURE == BSP_ENABLED
+
+bspStatus_t bspExtiAttachCapture(bspGpioPin_t pin, bspExtiEdge_t edge, 
+      bspExtiCb_t cb, void *pCtx)
+{
+   extiRing_t *pRing = 0;
+   bspStatus_t ret;
+   uint32_t crit;
+
+   if (extiLine(pin) < 0)
+      return BSP_EEINVAL;
+
+   crit = bspCriticalEnter();
+
+   for (uint32_t i = 0; i < BSP_EXTI_CAPTURE_NUM; i++)
+   {
+      if (!extiRings[i].Used)
+      {
+         pRing = &extiRings[i];
+         pRing->Used = true;
+         break;
+      }
+   }
+
+   bspCriticalExit(crit);
+
+   if (pRing == 0)
+      return BSP_EBUSY;
+
+   pRing->Head = 0;
+   pRing->Tail = 0;
+   pRing->Lost = 0;
+   pRing->pPort = BSP_IOMAPPORT(pin);
+   pRing->Mask = BSP_IOMAPPIN(pin);
+
+   ret = extiAttach(pin, edge, cb, pCtx, pRing);
+   if (ret != BSP_OK)
+      pRing->Used = false;
+
+   return ret;
 }
-#endif
+
+uint32_t bspExtiRead(bspGpioPin_t pin, bspExtiEvent_t *pEv, uint32_t max)
+{
+   int32_t line = extiLine(pin);
+   extiRing_t *pRing;
+   uint32_t head, tail, cnt = 0;
+
+   if (line < 0 || extiTable[line].pRing == 0)
+      return 0;
+
+   pRing = extiTable[line].pRing;
+   tail = pRing->Tail;
+   head = pRing->Head;
+   __DMB();
+
+   while (tail != head && cnt < max)
+   {
+      pEv[cnt++] = pRing->Ev[tail & (BSP_EXTI_CAPTURE_SIZE - 1)];
+      tail++;
+   }
+
+   __DMB();
+   pRing->Tail = tail;
+
+   return cnt;
+}
+
+uint32_t bspExtiGetLost(bspGpioPin_t pin)
+{
+   int32_t line = extiLine(pin);
+
+   if (line < 0 || extiTable[line].pRing == 0)
+      return 0;
+
+   return extiTable[line].pRing->Lost;
+}
+
+bspStatus_t bspExtiCalcStats(const bspExtiEvent_t *pEv, uint32_t cnt, 
+      bspExtiStats_t *pStats)
+{
+   uint64_t periodSum = 0;
+   uint64_t activeSum = 0;
+   uint32_t activeCnt = 0;
+   uint32_t ref, lastRef, activeMean;
+   bool waiting;
+
+   memset(pStats, 0, sizeof(bspExtiStats_t));
+
+   if (cnt == 0)
+      return BSP_EEMPTY;
+
+   /* The time from a reference edge to the next opposite edge is the high
+    * time if the reference edge is a rising one, else the low time */
+   ref = pEv[0].Level;
+   lastRef = pEv[0].Time;
+   waiting = true;
+   pStats->PeriodMin = UINT32_MAX;
+
+   for (uint32_t i = 1; i < cnt; i++)
+   {
+      if (pEv[i].Level == ref)
+      {
+         uint32_t period = pEv[i].Time - lastRef;
+
+         if (period < pStats->PeriodMin)
+            pStats->PeriodMin = period;
+
+         if (period > pStats->PeriodMax)
+            pStats->PeriodMax = period;
+
+         periodSum += period;
+         pStats->Periods++;
+         lastRef = pEv[i].Time;
+         waiting = true;
+      }
+      else if (waiting)
+      {
+         activeSum += pEv[i].Time - lastRef;
+         activeCnt++;
+         waiting = false;
+      }
+   }
+
+   if (pStats->Periods == 0 || periodSum == 0)
+   {
+      memset(pStats, 0, sizeof(bspExtiStats_t));
+      return BSP_EEMPTY;
+   }
+
+   pStats->PeriodMean = periodSum / pStats->Periods;
+   pStats->FreqMilliHz = ((uint64_t) SystemCoreClock * 1000) / 
+         pStats->PeriodMean;
+
+   if (activeCnt != 0)
+   {
+      activeMean = activeSum / activeCnt;
+
+      if (ref != 0)
+         pStats->HighMean = activeMean;
+      else if (activeMean < pStats->PeriodMean)
+         pStats->HighMean = pStats->PeriodMean - activeMean;
+
+      pStats->DutyPermille = ((uint64_t) pStats->HighMean * 1000) / 
+            pStats->PeriodMean;
+   }
+
+   return BSP_OK;
+}
+
+#endif /* BSP_EXTI_CAPTURE == BSP_ENABLED */
 
 void bspExtiInit(void)
 {  
-   LL_EXTI_InitTypeDef init;
-
-   LL_SYSCFG_SetEXTISource(
-         BSP_BUTTON_GPIO_EXTI_PORT, BSP_BUTTON_GPIO_EXTI_LINE); 
- 
-   LL_EXTI_StructInit(&init);
-   init.Line_0_31   = BSP_BUTTON_EXTI_LINE;
-   init.LineCommand = ENABLE;
-   init.Mode        = LL_EXTI_MODE_IT;
-   init.Trigger     = LL_EXTI_TRIGGER_FALLING;
-   LL_EXTI_Init(&init);
-  
-   NVIC_EnableIRQ(EXTI15_10_IRQn); 
-   NVIC_SetPriority(EXTI15_10_IRQn, BSP_IRQPRIO_EXTI);
+#if BSP_DEBOUNCE != BSP_ENABLED || BSP_DEBOUNCE_BUTTON != BSP_ENABLED
+
+   bspExtiAttach(BSP_GPIO_BUTTON, BSP_EXTI_FALLING, extiButtonCb, 0);
+
+#endif
 }
@@ -21,99 +21,116 @@
  */
 
 #include <bsp/bsp_gpio.h>
+#include <bsp/bsp_trace.h>
 
 /**
- * @brief Derives the gpio port from the bsp gipo pin ID.
+ * @brief The pins used by the bsp internally, extended by the board specific
+ * pins from BSP_GPIO_BOARD_PINS if defined.
  */
-#define BSP_IOMAPPORT(_val)     											\
-																			\
-		((GPIO_TypeDef *) (AHB1PERIPH_BASE + (((uint32_t)_val) >> 16)))
-
-/**
- * @brief Derives the bit mask for enabling the gpio clock from the bsp gpio 
- * pin ID.
- */
-#define BSP_IOMAPPEN(_val)      (0x1 << (((uint32_t)_val) >> 26))
-
-/**
- * @brief Derives the bit mask for accessing the gpio pin from the bsp gpio 
- * pin ID.
- */
-#define BSP_IOMAPPIN(_val)      (((uint32_t)_val) & 0xFFFF)
+static constexpr bspGpioCfg_t bspPins[] =
+{
+    /* LED */
+    {
+        BSP_GPIO_LED, LL_GPIO_MODE_OUTPUT, LL_GPIO_SPEED_FREQ_MEDIUM,
+        LL_GPIO_OUTPUT_PUSHPULL, LL_GPIO_PULL_DOWN, LL_GPIO_AF_0, 0
+    },
+
+    /* Button */
+    {
+        BSP_GPIO_BUTTON, LL_GPIO_MODE_INPUT, LL_GPIO_SPEED_FREQ_MEDIUM,
+        LL_GPIO_OUTPUT_PUSHPULL, LL_GPIO_PULL_DOWN, LL_GPIO_AF_0, 0
+    },
+
+    /* TTY */
+    {
+        BSP_GPIO_TTY_TX, LL_GPIO_MODE_ALTERNATE, LL_GPIO_SPEED_FREQ_HIGH,
+        LL_GPIO_OUTPUT_PUSHPULL, LL_GPIO_PULL_UP, LL_GPIO_AF_7, 0
+    },
+    {
+        BSP_GPIO_TTY_RX, LL_GPIO_MODE_ALTERNATE, LL_GPIO_SPEED_FREQ_HIGH,
+        LL_GPIO_OUTPUT_PUSHPULL, LL_GPIO_PULL_UP, LL_GPIO_AF_7, 0
+    },
+
+#if BSP_ICAP == BSP_ENABLED
+
+    /* Input capture meter, TIM5_CH1 see bsp_icap.h */
+    {
+        BSP_GPIO_ICAP, LL_GPIO_MODE_ALTERNATE, LL_GPIO_SPEED_FREQ_HIGH,
+        LL_GPIO_OUTPUT_PUSHPULL, LL_GPIO_PULL_NO, LL_GPIO_AF_2, 0
+    },
+
+#endif /* BSP_ICAP == BSP_ENABLED */
+
+#if BSP_TRACE == BSP_ENABLED
+
+    /* Debug pins, see bsp_trace.h */
+    {
+        BSP_DEBUGPIN_0, LL_GPIO_MODE_OUTPUT, LL_GPIO_SPEED_FREQ_VERY_HIGH,
+        LL_GPIO_OUTPUT_PUSHPULL, LL_GPIO_PULL_NO, LL_GPIO_AF_0, 0
+    },
+    {
+        BSP_DEBUGPIN_1, LL_GPIO_MODE_OUTPUT, LL_GPIO_SPEED_FREQ_VERY_HIGH,
+        LL_GPIO_OUTPUT_PUSHPULL, LL_GPIO_PULL_NO, LL_GPIO_AF_0, 0
+    },
+    {
+        BSP_DEBUGPIN_2, LL_GPIO_MODE_OUTPUT, LL_GPIO_SPEED_FREQ_VERY_HIGH,
+        LL_GPIO_OUTPUT_PUSHPULL, LL_GPIO_PULL_NO, LL_GPIO_AF_0, 0
+    },
+    {
+        BSP_DEBUGPIN_3, LL_GPIO_MODE_OUTPUT, LL_GPIO_SPEED_FREQ_VERY_HIGH,
+        LL_GPIO_OUTPUT_PUSHPULL, LL_GPIO_PULL_NO, LL_GPIO_AF_0, 0
+    },
+
+#endif /* BSP_TRACE == BSP_ENABLED */
+
+#ifdef BSP_GPIO_BOARD_PINS
+
+    /* Board specific pins from bsp_config.h */
+    BSP_GPIO_BOARD_PINS
+
+#endif /* BSP_GPIO_BOARD_PINS */
+};
 
 void bspGpioPinInit(bspGpioPin_t pin, LL_GPIO_InitTypeDef *init)
 {
-	__IO uint32_t tmp = BSP_IOMAPPEN(pin);
+    __IO uint32_t tmp = BSP_IOMAPPEN(pin);
 
-	SET_BIT(RCC->AHB1ENR, tmp);
-	tmp = READ_BIT(RCC->AHB2ENR, tmp);
+    SET_BIT(RCC->AHB1ENR, tmp);
+    tmp = READ_BIT(RCC->AHB1ENR, tmp);
 
-	init->Pin = BSP_IOMAPPIN(pin);
+    init->Pin = BSP_IOMAPPIN(pin);
     LL_GPIO_Init(BSP_IOMAPPORT(pin), init);
 }
 
-void bspGpioInit(void)
-{
-    LL_GPIO_InitTypeDef init;
-
-	/* LED */
-    init.Mode = LL_GPIO_MODE_OUTPUT;
-    init.OutputType = LL_GPIO_OUTPUT_PUSHPULL;
-    init.Pull = LL_GPIO_PULL_DOWN;
-    init.Speed = LL_GPIO_SPEED_FREQ_MEDIUM;
-    bspGpioPinInit(BSP_GPIO_LED, &init);
-
-	/* Button */
-	init.Mode = LL_GPIO_MODE_INPUT;
-    init.Pull = LL_GPIO_PULL_DOWN;
-    bspGpioPinInit(BSP_GPIO_BUTTON, &init);
-
-	/* TTY */
-    init.Mode = LL_GPIO_MODE_ALTERNATE;
-    init.OutputType = LL_GPIO_OUTPUT_PUSHPULL;
-    init.Pull = LL_GPIO_PULL_UP;
-    init.Speed = LL_GPIO_SPEED_FREQ_HIGH;
-	init.Alternate = LL_GPIO_AF_7;
-    bspGpioPinInit(BSP_GPIO_TTY_TX, &init);
-    bspGpioPinInit(BSP_GPIO_TTY_RX, &init);
-}
-
-void bspGpioSet(bspGpioPin_t pin)
+void bspGpioInitBatch(const bspGpioBatch_t *pBatch)
 {
-	GPIO_TypeDef* port = BSP_IOMAPPORT(pin);
-	uint32_t io_pin = BSP_IOMAPPIN(pin);
-
-	WRITE_REG(port->BSRR, io_pin);
+    __IO uint32_t tmp;
+
+    /* Enable all needed clocks at once, the read back ensures the delay 
+     * needed before the ports can be accessed */
+    SET_BIT(RCC->AHB1ENR, pBatch->ClkEn);
+    tmp = READ_BIT(RCC->AHB1ENR, pBatch->ClkEn);
+    (void) tmp;
+
+    for (uint32_t idx = 0; idx < BSP_GPIO_NUMPORTS; idx++)
+    {
+        const bspGpioPortCfg_t *pCfg = &pBatch->Port[idx];
+        GPIO_TypeDef *port = (GPIO_TypeDef *)(GPIOA_BASE + idx * 0x400UL);
+
+        if (pCfg->ModerMsk == 0)
+            continue;
+
+        WRITE_REG(port->BSRR, pCfg->Bsrr);
+        MODIFY_REG(port->OTYPER, pCfg->OtyperMsk, pCfg->Otyper);
+        MODIFY_REG(port->OSPEEDR, pCfg->OspeedrMsk, pCfg->Ospeedr);
+        MODIFY_REG(port->PUPDR, pCfg->PupdrMsk, pCfg->Pupdr);
+        MODIFY_REG(port->AFR[0], pCfg->AfrMsk[0], pCfg->Afr[0]);
+        MODIFY_REG(port->AFR[1], pCfg->AfrMsk[1], pCfg->Afr[1]);
+        MODIFY_REG(port->MODER, pCfg->ModerMsk, pCfg->Moder);
+    }
 }
 
-void bspGpioClear(bspGpioPin_t pin)
-{
-	GPIO_TypeDef* port = BSP_IOMAPPORT(pin);
-	uint32_t io_pin = BSP_IOMAPPIN(pin);
-
-	WRITE_REG(port->BSRR, io_pin << 16);
-}
-
-void bspGpioToggle(bspGpioPin_t pin)
-{
-	GPIO_TypeDef* port = BSP_IOMAPPORT(pin);
-	uint32_t io_pin = BSP_IOMAPPIN(pin);
-
-	WRITE_REG(port->ODR, READ_REG(port->ODR) ^ io_pin);
-}
-
-void bspGpioWrite(bspGpioPin_t pin, bool val)
-{
-	if(val == true)
-		bspGpioSet(pin);
-	else
-		bspGpioClear(pin);
-}
-
-bool bspGpioRead(bspGpioPin_t pin)
+void bspGpioInit(void)
 {
-	GPIO_TypeDef* port = BSP_IOMAPPORT(pin);
-	uint32_t io_pin = BSP_IOMAPPIN(pin);
-
-	return (READ_REG(port->IDR) & io_pin) ? true : false;
+    BSP_GPIO_INIT_TABLE(bspPins);
 }
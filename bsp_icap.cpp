@@ -0,0 +1,263 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+#include <stm32f4xx_ll_dma.h>
+#include <stm32f4xx_ll_tim.h>
+
+#include "bsp/bsp.h"
+#include "bsp/bsp_dma.h"
+#include "bsp/bsp_isr.h"
+#include "bsp/bsp_icap.h"
+
+#include <string.h>
+
+#if BSP_ICAP == BSP_ENABLED
+
+/**
+ * @brief The timer and its DMA streams, see BSP_ICAP_RISE_REQ and 
+ * BSP_ICAP_FALL_REQ.
+ */
+#define ICAP_TIM                            TIM5
+#define ICAP_DMA                            bspDmaGetDma(BSP_ICAP_RISE_REQ)
+#define ICAP_RISE_STR                       bspDmaGetStream(BSP_ICAP_RISE_REQ)
+#define ICAP_FALL_STR                       bspDmaGetStream(BSP_ICAP_FALL_REQ)
+#define ICAP_DMA_CH                         bspDmaGetChannel(BSP_ICAP_RISE_REQ)
+
+static_assert(
+    bspDmaMap[BSP_ICAP_RISE_REQ].Dma == bspDmaMap[BSP_ICAP_FALL_REQ].Dma &&
+    bspDmaMap[BSP_ICAP_RISE_REQ].Channel == bspDmaMap[BSP_ICAP_FALL_REQ].Channel,
+    "Both icap requests have to use the same DMA and channel");
+
+/**
+ * @brief Capture buffers, written by the DMA.
+ */
+static struct
+{
+    uint32_t Rise[BSP_ICAP_SIZE];
+    uint32_t Fall[BSP_ICAP_SIZE];
+    volatile bool RiseFull;
+    volatile bool FallFull;
+
+} icapData;
+
+/**
+ * @brief Only the first transfer complete interrupt of each stream is used, 
+ * to know when its buffer has been filled completely.
+ * 
+ * @param pCtx      The full flag of the stream.
+ */
+static void icapDmaIsr(uint32_t flags, void *pCtx)
+{
+    BSP_ISR_ENTER(BSP_ISR_ICAP);
+
+    if (pCtx == &icapData.RiseFull)
+        LL_DMA_DisableIT_TC(ICAP_DMA, ICAP_RISE_STR);
+    else
+        LL_DMA_DisableIT_TC(ICAP_DMA, ICAP_FALL_STR);
+
+    *(volatile bool *) pCtx = true;
+
+    BSP_ISR_EXIT(BSP_ISR_ICAP);
+}
+
+/**
+ * @brief Configures the given stream to copy the given capture register to 
+ * the given buffer.
+ */
+static void icapDmaInit(uint32_t stream, volatile uint32_t *pReg, 
+    uint32_t *pBuf)
+{
+    LL_DMA_InitTypeDef dma;
+
+    LL_DMA_StructInit(&dma);
+    dma.Channel = ICAP_DMA_CH;
+    dma.Mode = LL_DMA_MODE_CIRCULAR;
+    dma.Direction = LL_DMA_DIRECTION_PERIPH_TO_MEMORY;
+    dma.Priority = LL_DMA_PRIORITY_HIGH;
+    dma.MemoryOrM2MDstIncMode = LL_DMA_MEMORY_INCREMENT;
+    dma.PeriphOrM2MSrcIncMode = LL_DMA_PERIPH_NOINCREMENT;
+    dma.MemoryOrM2MDstDataSize = LL_DMA_MDATAALIGN_WORD;
+    dma.PeriphOrM2MSrcDataSize = LL_DMA_PDATAALIGN_WORD;
+    dma.PeriphOrM2MSrcAddress = (uint32_t) pReg;
+    dma.MemoryOrM2MDstAddress = (uint32_t) pBuf;
+    dma.NbData = BSP_ICAP_SIZE;
+    LL_DMA_Init(ICAP_DMA, stream, &dma);
+}
+
+/**
+ * @brief Returns the number of captures written by the given stream since
+ * the start, up to BSP_ICAP_SIZE.
+ * 
+ * @param full      The full flag of the stream.
+ * @param pLatest   Where to store the index of the latest capture.
+ */
+static inline uint32_t icapWritten(uint32_t stream, bool full, 
+    uint32_t *pLatest)
+{
+    uint32_t next = BSP_ICAP_SIZE - LL_DMA_GetDataLength(ICAP_DMA, stream);
+
+    *pLatest = (next + BSP_ICAP_SIZE - 1) % BSP_ICAP_SIZE;
+
+    return full ? BSP_ICAP_SIZE : next;
+}
+
+/**
+ * @brief Returns the index n captures before idx.
+ */
+static inline uint32_t icapPrev(uint32_t idx, uint32_t n)
+{
+    return (idx + BSP_ICAP_SIZE - n) % BSP_ICAP_SIZE;
+}
+
+void bspIcapInit(void)
+{
+    /* Free running over the full 32 bit range at the timer clock */
+    LL_TIM_SetPrescaler(ICAP_TIM, 0);
+    LL_TIM_SetAutoReload(ICAP_TIM, UINT32_MAX);
+    LL_TIM_GenerateEvent_UPDATE(ICAP_TIM);
+
+    /* Channel 1 captures the rising edges on TI1, channel 2 the falling 
+     * ones on the same input */
+    LL_TIM_IC_SetActiveInput(ICAP_TIM, LL_TIM_CHANNEL_CH1, 
+        LL_TIM_ACTIVEINPUT_DIRECTTI);
+    LL_TIM_IC_SetPolarity(ICAP_TIM, LL_TIM_CHANNEL_CH1, 
+        LL_TIM_IC_POLARITY_RISING);
+    LL_TIM_IC_SetFilter(ICAP_TIM, LL_TIM_CHANNEL_CH1, BSP_ICAP_FILTER);
+    LL_TIM_IC_SetPrescaler(ICAP_TIM, LL_TIM_CHANNEL_CH1, LL_TIM_ICPSC_DIV1);
+
+    LL_TIM_IC_SetActiveInput(ICAP_TIM, LL_TIM_CHANNEL_CH2, 
+        LL_TIM_ACTIVEINPUT_INDIRECTTI);
+    LL_TIM_IC_SetPolarity(ICAP_TIM, LL_TIM_CHANNEL_CH2, 
+        LL_TIM_IC_POLARITY_FALLING);
+    LL_TIM_IC_SetFilter(ICAP_TIM, LL_TIM_CHANNEL_CH2, BSP_ICAP_FILTER);
+    LL_TIM_IC_SetPrescaler(ICAP_TIM, LL_TIM_CHANNEL_CH2, LL_TIM_ICPSC_DIV1);
+
+    icapDmaInit(ICAP_RISE_STR, &ICAP_TIM->CCR1, icapData.Rise);
+    icapDmaInit(ICAP_FALL_STR, &ICAP_TIM->CCR2, icapData.Fall);
+
+    bspDmaClaim(BSP_ICAP_RISE_REQ, icapDmaIsr, (void *) &icapData.RiseFull,
+        BSP_IRQPRIO_ICAP);
+    bspDmaClaim(BSP_ICAP_FALL_REQ, icapDmaIsr, (void *) &icapData.FallFull,
+        BSP_IRQPRIO_ICAP);
+}
+
+void bspIcapStart(void)
+{
+    bspIcapStop();
+
+    icapData.RiseFull = false;
+    icapData.FallFull = false;
+
+    /* Restart at the beginning of the buffers */
+    LL_DMA_SetDataLength(ICAP_DMA, ICAP_RISE_STR, BSP_ICAP_SIZE);
+    LL_DMA_SetDataLength(ICAP_DMA, ICAP_FALL_STR, BSP_ICAP_SIZE);
+    LL_DMA_EnableIT_TC(ICAP_DMA, ICAP_RISE_STR);
+    LL_DMA_EnableIT_TC(ICAP_DMA, ICAP_FALL_STR);
+    LL_DMA_EnableStream(ICAP_DMA, ICAP_RISE_STR);
+    LL_DMA_EnableStream(ICAP_DMA, ICAP_FALL_STR);
+
+    LL_TIM_EnableDMAReq_CC1(ICAP_TIM);
+    LL_TIM_EnableDMAReq_CC2(ICAP_TIM);
+    LL_TIM_CC_EnableChannel(ICAP_TIM, 
+        LL_TIM_CHANNEL_CH1 | LL_TIM_CHANNEL_CH2);
+    LL_TIM_EnableCounter(ICAP_TIM);
+}
+
+void bspIcapStop(void)
+{
+    LL_TIM_DisableCounter(ICAP_TIM);
+    LL_TIM_CC_DisableChannel(ICAP_TIM, 
+        LL_TIM_CHANNEL_CH1 | LL_TIM_CHANNEL_CH2);
+    LL_TIM_DisableDMAReq_CC1(ICAP_TIM);
+    LL_TIM_DisableDMAReq_CC2(ICAP_TIM);
+
+    LL_DMA_DisableIT_TC(ICAP_DMA, ICAP_RISE_STR);
+    LL_DMA_DisableIT_TC(ICAP_DMA, ICAP_FALL_STR);
+    bspDmaStop(BSP_ICAP_RISE_REQ);
+    bspDmaStop(BSP_ICAP_FALL_REQ);
+}
+
+bspStatus_t bspIcapMeasure(uint32_t n, bspIcapResult_t *pRes)
+{
+    uint32_t fall, rise, fallCnt, riseCnt, mean, now;
+    int32_t age;
+    uint64_t tmp;
+
+    memset(pRes, 0, sizeof(bspIcapResult_t));
+
+    if (n == 0 || n > BSP_ICAP_SIZE / 2)
+        return BSP_EEINVAL;
+
+    /* Read the falling edges first, so the latest rising edge can only be 
+     * newer and not the other way round */
+    fallCnt = icapWritten(ICAP_FALL_STR, icapData.FallFull, &fall);
+    riseCnt = icapWritten(ICAP_RISE_STR, icapData.RiseFull, &rise);
+
+    /* After the positions, so the latest edge can not be newer */
+    now = LL_TIM_GetCounter(ICAP_TIM);
+
+    if (riseCnt < n + 1)
+        return BSP_EEMPTY;
+
+    pRes->Periods = n;
+    pRes->Ticks = icapData.Rise[rise] - icapData.Rise[icapPrev(rise, n)];
+    pRes->Clock = bspGetTimClock(ICAP_TIM);
+    mean = pRes->Ticks / n;
+
+    if (mean == 0)
+        return BSP_EEMPTY;
+
+    /* Negative in case a edge has been captured after all */
+    age = (int32_t)(now - icapData.Rise[rise]);
+    if (age > 0 && (uint32_t) age / 2 > mean)
+        return BSP_ETIMEOUT;
+
+    /* Pair the latest falling edge with the rising edge before it, the high
+     * time has to be shorter than a period */
+    if (icapData.Fall[fall] - icapData.Rise[rise] >= mean)
+    {
+        rise = icapPrev(rise, 1);
+        riseCnt--;
+    }
+
+    if (   fallCnt >= n && riseCnt >= n + 1 
+        && icapData.Fall[fall] - icapData.Rise[rise] < mean)
+    {
+        for (uint32_t i = 0; i < n; i++)
+        {
+            pRes->HighTicks += icapData.Fall[icapPrev(fall, i)] - 
+                icapData.Rise[icapPrev(rise, i)];
+        }
+    }
+
+    tmp = (uint64_t) pRes->Clock * n;
+    pRes->FreqHz = (tmp + pRes->Ticks / 2) / pRes->Ticks;
+
+    tmp = (tmp * 1000) / pRes->Ticks;
+    pRes->FreqMilliHz = tmp > UINT32_MAX ? UINT32_MAX : (uint32_t) tmp;
+
+    pRes->DutyPermille = ((uint64_t) pRes->HighTicks * 1000) / pRes->Ticks;
+
+    return BSP_OK;
+}
+
+#endif /* BSP_ICAP == BSP_ENABLED */
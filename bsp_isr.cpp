@@ -0,0 +1,180 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+#include "bsp/bsp.h"
+#include "bsp/bsp_isr.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if BSP_ISR_STATS == BSP_ENABLED
+
+/**
+ * @brief Names used when printing the statistics, order as in bspIsrId_t.
+ */
+static const char *isrNames[BSP_ISR_CNT] =
+{
+    "systick",
+    "tty usart",
+    "tty txdma",
+    "exti0",
+    "exti1",
+    "exti2",
+    "exti3",
+    "exti4",
+    "exti9_5",
+    "exti15_10",
+    "prof tim7",
+    "wave dma",
+    "capture dma",
+    "icap dma",
+    "m2m dma",
+    "work pendsv",
+    "sched level1",
+    "sched level2",
+    "sched level3",
+};
+
+/**
+ * @brief The statistics of all isr's.
+ */
+static bspIsrStat_t isrStat[BSP_ISR_CNT];
+
+/**
+ * @brief Adds the given value to the given histogram.
+ */
+static inline void isrHistAdd(bspIsrHist_t *pHist, uint32_t cycles)
+{
+    uint32_t idx = 0;
+
+    if (cycles != 0)
+        idx = 31 - __CLZ(cycles);
+
+    if (idx >= BSP_ISR_STATS_BUCKETS)
+        idx = BSP_ISR_STATS_BUCKETS - 1;
+
+    if (pHist->Bucket[idx] != UINT32_MAX)
+        pHist->Bucket[idx]++;
+
+    if (cycles < pHist->Min)
+        pHist->Min = cycles;
+
+    if (cycles > pHist->Max)
+        pHist->Max = cycles;
+
+    pHist->Sum += cycles;
+    pHist->Cnt++;
+}
+
+/**
+ * @brief Clears the given histogram.
+ */
+static void isrHistClear(bspIsrHist_t *pHist)
+{
+    memset(pHist, 0, sizeof(bspIsrHist_t));
+    pHist->Min = UINT32_MAX;
+}
+
+/**
+ * @brief Prints a 64 bit counter without the need for %llu which is not
+ * supported by newlib nano.
+ */
+static void isrPrintU64(uint64_t val)
+{
+    if (val >= 1000000000)
+        printf("%10lu%09lu", (unsigned long)(val / 1000000000),
+            (unsigned long)(val % 1000000000));
+    else
+        printf("%10lu", (unsigned long) val);
+}
+
+/**
+ * @brief Prints a single histogram.
+ */
+static void isrHistDump(const char *pName, bspIsrHist_t *pHist)
+{
+    if (pHist->Cnt == 0)
+        return;
+
+    printf("  %-8s cnt ", pName);
+    isrPrintU64(pHist->Cnt);
+    printf(" min %8lu mean %8lu max %8lu\n", (unsigned long) pHist->Min,
+        (unsigned long)(pHist->Sum / pHist->Cnt), (unsigned long) pHist->Max);
+
+    printf("          ");
+    for (uint32_t i = 0; i < BSP_ISR_STATS_BUCKETS; i++)
+    {
+        if (pHist->Bucket[i] != 0)
+            printf(" %s2^%lu:%lu", i == BSP_ISR_STATS_BUCKETS - 1 ? ">=" : "",
+                (unsigned long) i, (unsigned long) pHist->Bucket[i]);
+    }
+    printf("\n");
+}
+
+void bspIsrStatExec(bspIsrId_t id, uint32_t cycles)
+{
+    isrHistAdd(&isrStat[id].Exec, cycles);
+}
+
+void bspIsrStatLatency(bspIsrId_t id, uint32_t cycles)
+{
+    isrHistAdd(&isrStat[id].Latency, cycles);
+}
+
+void bspIsrStatGet(bspIsrId_t id, bspIsrStat_t *pStat)
+{
+    uint32_t crit = bspCriticalEnter();
+
+    memcpy(pStat, &isrStat[id], sizeof(bspIsrStat_t));
+    bspCriticalExit(crit);
+}
+
+void bspIsrStatReset(void)
+{
+    uint32_t crit = bspCriticalEnter();
+
+    for (uint32_t id = 0; id < BSP_ISR_CNT; id++)
+    {
+        isrHistClear(&isrStat[id].Exec);
+        isrHistClear(&isrStat[id].Latency);
+    }
+    bspCriticalExit(crit);
+}
+
+void bspIsrStatDump(void)
+{
+    bspIsrStat_t stat;
+
+    printf("isr statistics in cycles @ %lu Hz:\n",
+        (unsigned long) SystemCoreClock);
+
+    for (uint32_t id = 0; id < BSP_ISR_CNT; id++)
+    {
+        bspIsrStatGet((bspIsrId_t) id, &stat);
+
+        printf("%s\n", isrNames[id]);
+        isrHistDump("exec", &stat.Exec);
+        isrHistDump("latency", &stat.Latency);
+    }
+}
+
+#endif /* BSP_ISR_STATS == BSP_ENABLED */
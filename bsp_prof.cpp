@@ -0,0 +1,257 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+#include <stm32f4xx_ll_tim.h>
+
+#include "bsp/bsp.h"
+#include "bsp/bsp_isr.h"
+#include "bsp/bsp_prof.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if BSP_PROF == BSP_ENABLED
+
+#if (BSP_PROF_SIZE & (BSP_PROF_SIZE - 1)) != 0
+#error BSP_PROF_SIZE has to be a power of two
+#endif
+
+/**
+ * @brief Maximum number of hash table entries to probe for a free slot,
+ * bounds the time spent in the sample interrupt.
+ */
+#define BSP_PROF_PROBES                     8
+
+/**
+ * @brief Profiler data shared with the sample interrupt.
+ */
+static struct
+{
+    volatile bool Running;
+    uint32_t Rate;
+    uint32_t Samples;
+    uint32_t Dropped;
+
+#if BSP_PROF_MODE == BSP_PROF_MODE_HASH
+
+    struct
+    {
+        uint32_t Pc;
+        uint32_t Cnt;
+
+    } Hash[BSP_PROF_SIZE];
+
+#else /* BSP_PROF_MODE == BSP_PROF_MODE_HASH */
+
+    struct
+    {
+        uint32_t Pc;
+        uint32_t Lr;
+
+    } Ring[BSP_PROF_SIZE];
+
+    volatile uint32_t Head;
+    volatile uint32_t Tail;
+
+#endif /* BSP_PROF_MODE == BSP_PROF_MODE_HASH */
+
+} profData;
+
+/**
+ * @brief Returns the sample rate in Hz.
+ */
+static inline uint32_t profRate(void)
+{
+#if BSP_PROF_TIMER == BSP_ENABLED
+
+    return profData.Rate;
+
+#else
+
+    return 1000;
+
+#endif
+}
+
+#if BSP_PROF_TIMER == BSP_ENABLED
+
+/**
+ * @brief The sample timer interrupt, see bspProfTimIsr().
+ */
+BSP_EXC_FRAME_HANDLER(TIM7_IRQHandler, bspProfTimIsr)
+
+extern "C" void bspProfTimIsr(bspExcFrame_t *pFrame)
+{
+    BSP_ISR_ENTER(BSP_ISR_PROF);
+
+    LL_TIM_ClearFlag_UPDATE(TIM7);
+    bspProfSample(pFrame);
+
+    BSP_ISR_EXIT(BSP_ISR_PROF);
+}
+
+#endif /* BSP_PROF_TIMER == BSP_ENABLED */
+
+void bspProfInit(void)
+{
+    bspProfReset();
+
+#if BSP_PROF_TIMER == BSP_ENABLED
+
+    profData.Rate = bspTimSetRate(TIM7, BSP_PROF_RATE_HZ);
+    LL_TIM_EnableIT_UPDATE(TIM7);
+
+    bspIrqEnable(TIM7_IRQn, BSP_IRQPRIO_PROF);
+
+#endif /* BSP_PROF_TIMER == BSP_ENABLED */
+}
+
+void bspProfStart(void)
+{
+    profData.Running = true;
+
+#if BSP_PROF_TIMER == BSP_ENABLED
+
+    LL_TIM_EnableCounter(TIM7);
+
+#endif /* BSP_PROF_TIMER == BSP_ENABLED */
+}
+
+void bspProfStop(void)
+{
+#if BSP_PROF_TIMER == BSP_ENABLED
+
+    LL_TIM_DisableCounter(TIM7);
+
+#endif /* BSP_PROF_TIMER == BSP_ENABLED */
+
+    profData.Running = false;
+}
+
+void bspProfReset(void)
+{
+    uint32_t crit = bspCriticalEnter();
+
+    profData.Samples = 0;
+    profData.Dropped = 0;
+
+#if BSP_PROF_MODE == BSP_PROF_MODE_HASH
+
+    memset(profData.Hash, 0, sizeof(profData.Hash));
+
+#else /* BSP_PROF_MODE == BSP_PROF_MODE_HASH */
+
+    profData.Head = 0;
+    profData.Tail = 0;
+
+#endif /* BSP_PROF_MODE == BSP_PROF_MODE_HASH */
+
+    bspCriticalExit(crit);
+}
+
+void bspProfSample(bspExcFrame_t *pFrame)
+{
+    if (!profData.Running)
+        return;
+
+    profData.Samples++;
+
+#if BSP_PROF_MODE == BSP_PROF_MODE_HASH
+
+    uint32_t pc = pFrame->Pc;
+    uint32_t idx = ((pc >> 1) * 2654435761UL) >> 16;
+
+    for (uint32_t n = 0; n < BSP_PROF_PROBES; n++, idx++)
+    {
+        idx &= BSP_PROF_SIZE - 1;
+
+        if (profData.Hash[idx].Pc == pc)
+        {
+            profData.Hash[idx].Cnt++;
+            return;
+        }
+
+        if (profData.Hash[idx].Pc == 0)
+        {
+            profData.Hash[idx].Pc = pc;
+            profData.Hash[idx].Cnt = 1;
+            return;
+        }
+    }
+
+    profData.Dropped++;
+
+#else /* BSP_PROF_MODE == BSP_PROF_MODE_HASH */
+
+    uint32_t head = profData.Head;
+
+    if (head - profData.Tail >= BSP_PROF_SIZE)
+    {
+        profData.Dropped++;
+        return;
+    }
+
+    profData.Ring[head & (BSP_PROF_SIZE - 1)].Pc = pFrame->Pc;
+    profData.Ring[head & (BSP_PROF_SIZE - 1)].Lr = pFrame->Lr;
+    profData.Head = head + 1;
+
+#endif /* BSP_PROF_MODE == BSP_PROF_MODE_HASH */
+}
+
+void bspProfDump(void)
+{
+#if BSP_PROF_MODE == BSP_PROF_MODE_HASH
+
+    printf("#prof hash %lu\n", (unsigned long) profRate());
+
+    for (uint32_t idx = 0; idx < BSP_PROF_SIZE; idx++)
+    {
+        if (profData.Hash[idx].Cnt != 0)
+        {
+            printf("%08lx %lu\n", (unsigned long) profData.Hash[idx].Pc,
+                (unsigned long) profData.Hash[idx].Cnt);
+        }
+    }
+
+#else /* BSP_PROF_MODE == BSP_PROF_MODE_HASH */
+
+    uint32_t tail = profData.Tail;
+
+    printf("#prof ring %lu\n", (unsigned long) profRate());
+
+    while (tail != profData.Head)
+    {
+        printf("%08lx %08lx\n",
+            (unsigned long) profData.Ring[tail & (BSP_PROF_SIZE - 1)].Pc,
+            (unsigned long) profData.Ring[tail & (BSP_PROF_SIZE - 1)].Lr);
+
+        tail++;
+        profData.Tail = tail;
+    }
+
+#endif /* BSP_PROF_MODE == BSP_PROF_MODE_HASH */
+
+    printf("#end %lu %lu\n", (unsigned long) profData.Samples,
+        (unsigned long) profData.Dropped);
+}
+
+#endif /* BSP_PROF == BSP_ENABLED */
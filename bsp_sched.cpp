@@ -0,0 +1,314 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+
+#include "bsp/bsp.h"
+#include "bsp/bsp_isr.h"
+#include "bsp/bsp_sched.h"
+#include "bsp/bsp_tty.h"
+
+#include <stddef.h>
+
+#if BSP_SCHED == BSP_ENABLED
+
+#if BSP_SCHED_TASKS < 1 || BSP_SCHED_TASKS > 32
+#error BSP_SCHED_TASKS has to be in the range 1 to 32
+#endif
+
+#if BSP_SCHED_LEVELS < 1 || BSP_SCHED_LEVELS > 4
+#error BSP_SCHED_LEVELS has to be in the range 1 to 4
+#endif
+
+/**
+ * @brief Returns the interrupt used for the given level.
+ */
+static constexpr IRQn_Type schedIrq(uint32_t level)
+{
+    return level == 1 ? CEC_IRQn : level == 2 ? SPDIF_RX_IRQn : QUADSPI_IRQn;
+}
+
+/**
+ * @brief Scheduler data shared with the interrupts.
+ */
+static struct
+{
+    struct
+    {
+        bspSchedFn_t Fn;
+        void *pCtx;
+        uint32_t Level;
+        volatile uint32_t Events;
+        uint32_t Remain;
+        uint32_t Period;
+
+    } Task[BSP_SCHED_TASKS];
+
+    /* One bit per task with pending events */
+    volatile uint32_t Ready[BSP_SCHED_LEVELS];
+
+} schedData;
+
+/**
+ * @brief Atomically ors the given bits to *pVal.
+ */
+static inline void schedAtomicOr(volatile uint32_t *pVal, uint32_t bits)
+{
+    do
+    {
+        bits |= __LDREXW(pVal);
+    } while (__STREXW(bits, pVal) != 0);
+}
+
+/**
+ * @brief Atomically clears the given bits of *pVal.
+ */
+static inline void schedAtomicClear(volatile uint32_t *pVal, uint32_t bits)
+{
+    uint32_t val;
+
+    do
+    {
+        val = __LDREXW(pVal) & ~bits;
+    } while (__STREXW(val, pVal) != 0);
+}
+
+/**
+ * @brief Atomically reads and clears *pVal.
+ */
+static inline uint32_t schedAtomicTake(volatile uint32_t *pVal)
+{
+    uint32_t val;
+
+    do
+    {
+        val = __LDREXW(pVal);
+    } while (__STREXW(0, pVal) != 0);
+
+    return val;
+}
+
+/**
+ * @brief Runs all ready tasks of the given level, lowest ID first.
+ */
+static void schedRunLevel(uint32_t level)
+{
+    uint32_t ready, task, events;
+
+    while ((ready = schedData.Ready[level]) != 0)
+    {
+        task = __CLZ(__RBIT(ready));
+        schedAtomicClear(&schedData.Ready[level], 1UL << task);
+
+        /* Empty if already taken by a run which has been interrupted right 
+         * after clearing the ready bit */
+        events = schedAtomicTake(&schedData.Task[task].Events);
+
+        if (events != 0)
+            schedData.Task[task].Fn(schedData.Task[task].pCtx, events);
+    }
+}
+
+/**
+ * @brief The interrupt of a preemptive level. Hence that every level has an
+ * isr ID of its own, as the levels preempt each other.
+ */
+#define SCHED_ISR(_level, _id)                                              \
+                                                                            \
+    do                                                                      \
+    {                                                                       \
+        BSP_ISR_ENTER(_id);                                                 \
+        schedRunLevel(_level);                                              \
+        BSP_ISR_EXIT(_id);                                                  \
+    } while (0)
+
+#if BSP_SCHED_LEVELS > 1
+
+extern "C" void CEC_IRQHandler(void)
+{
+    SCHED_ISR(1, BSP_ISR_SCHED1);
+}
+
+#endif /* BSP_SCHED_LEVELS > 1 */
+
+#if BSP_SCHED_LEVELS > 2
+
+extern "C" void SPDIF_RX_IRQHandler(void)
+{
+    SCHED_ISR(2, BSP_ISR_SCHED2);
+}
+
+#endif /* BSP_SCHED_LEVELS > 2 */
+
+#if BSP_SCHED_LEVELS > 3
+
+extern "C" void QUADSPI_IRQHandler(void)
+{
+    SCHED_ISR(3, BSP_ISR_SCHED3);
+}
+
+#endif /* BSP_SCHED_LEVELS > 3 */
+
+#if BSP_TTY_RX_IRQ == BSP_ENABLED
+
+/**
+ * @brief The tty callback of bspSchedOnTTY(), the task ID is passed as 
+ * context.
+ */
+static void schedTTYCb(void *pCtx)
+{
+    bspSchedSignal((uint32_t) pCtx, BSP_SCHED_EV_TTY);
+}
+
+#endif /* BSP_TTY_RX_IRQ == BSP_ENABLED */
+
+/**
+ * @brief The EXTI callback of bspSchedOnExti(), the task ID is passed as 
+ * context.
+ */
+static void schedExtiCb(void *pCtx)
+{
+    bspSchedSignal((uint32_t) pCtx, BSP_SCHED_EV_EXTI);
+}
+
+void bspSchedInit(void)
+{
+    for (uint32_t level = 1; level < BSP_SCHED_LEVELS; level++)
+    {
+        bspIrqEnable(schedIrq(level), 
+            BSP_IRQPRIO_SCHED + BSP_SCHED_LEVELS - 1 - level);
+    }
+}
+
+bspStatus_t bspSchedAdd(uint32_t task, uint32_t level, bspSchedFn_t fn, 
+    void *pCtx)
+{
+    uint32_t crit = 0;
+
+    if (task >= BSP_SCHED_TASKS || level >= BSP_SCHED_LEVELS || fn == NULL)
+        return BSP_EEINVAL;
+
+    crit = bspCriticalEnter();
+
+    if (schedData.Task[task].Fn != NULL)
+    {
+        bspCriticalExit(crit);
+        return BSP_EBUSY;
+    }
+
+    schedData.Task[task].pCtx = pCtx;
+    schedData.Task[task].Level = level;
+    schedData.Task[task].Events = 0;
+    schedData.Task[task].Remain = 0;
+    schedData.Task[task].Fn = fn;
+
+    bspCriticalExit(crit);
+
+    return BSP_OK;
+}
+
+void bspSchedSignal(uint32_t task, uint32_t events)
+{
+    uint32_t level = 0;
+
+    if (task >= BSP_SCHED_TASKS || events == 0 || 
+        schedData.Task[task].Fn == NULL)
+        return;
+
+    level = schedData.Task[task].Level;
+
+    schedAtomicOr(&schedData.Task[task].Events, events);
+    schedAtomicOr(&schedData.Ready[level], 1UL << task);
+
+    /* Level 0 is woken up by the interrupt signaling it */
+    if (level != 0)
+        NVIC_SetPendingIRQ(schedIrq(level));
+}
+
+bspStatus_t bspSchedSetTimer(uint32_t task, uint32_t delay, uint32_t period)
+{
+    uint32_t crit = 0;
+
+    if (task >= BSP_SCHED_TASKS)
+        return BSP_EEINVAL;
+
+    crit = bspCriticalEnter();
+    schedData.Task[task].Period = period;
+    schedData.Task[task].Remain = delay;
+    bspCriticalExit(crit);
+
+    return BSP_OK;
+}
+
+#if BSP_TTY_RX_IRQ == BSP_ENABLED
+
+bspStatus_t bspSchedOnTTY(uint32_t task)
+{
+    if (task >= BSP_SCHED_TASKS)
+        return BSP_EEINVAL;
+
+    bspTTYSetRxNotify(schedTTYCb, (void *) task);
+
+    return BSP_OK;
+}
+
+#endif /* BSP_TTY_RX_IRQ == BSP_ENABLED */
+
+bspStatus_t bspSchedOnExti(uint32_t task, bspGpioPin_t pin, 
+    bspExtiEdge_t edge)
+{
+    if (task >= BSP_SCHED_TASKS)
+        return BSP_EEINVAL;
+
+    return bspExtiAttach(pin, edge, schedExtiCb, (void *) task);
+}
+
+void bspSchedTick(void)
+{
+    for (uint32_t task = 0; task < BSP_SCHED_TASKS; task++)
+    {
+        if (schedData.Task[task].Remain != 0 && 
+            --schedData.Task[task].Remain == 0)
+        {
+            schedData.Task[task].Remain = schedData.Task[task].Period;
+            bspSchedSignal(task, BSP_SCHED_EV_TIMER);
+        }
+    }
+}
+
+void bspSchedRun(void)
+{
+    while (1)
+    {
+        schedRunLevel(0);
+
+        /* PRIMASK as a pending interrupt wakes up the core from WFI even if
+         * masked by it, which closes the gap between the check and WFI */
+        __disable_irq();
+
+        if (schedData.Ready[0] == 0)
+            __WFI();
+
+        __enable_irq();
+    }
+}
+
+#endif /* BSP_SCHED == BSP_ENABLED */
@@ -21,12 +21,16 @@
  */
 
 #include <stm32f4xx_ll_usart.h>
+#include <stm32f4xx_ll_rcc.h>
 #include <stm32f4xx_ll_dma.h>
 
 #include "bsp/bsp.h"
 #include "bsp/bsp_assert.h"
+#include "bsp/bsp_dma.h"
 #include "bsp/bsp_gpio.h"
 #include "bsp/bsp_tty.h"
+#include "bsp/bsp_isr.h"
+#include "bsp/bsp_rtos.h"
 #include "generic/generic.hpp"
 #include "generic/fifo.hpp"
 
@@ -34,8 +38,37 @@
 #include <stdio.h>
 #include <errno.h>
 
+/**
+ * @brief The baud rate passed to bspTTYInit(), zero as long as the tty is 
+ * not initialized.
+ */
+static uint32_t ttyBaud = 0;
+
+#if BSP_RTOS == BSP_ENABLED
+
+/**
+ * @brief RTOS objects of the tty, see bsp_rtos.h.
+ */
+static struct
+{
+    SemaphoreHandle_t Mutex;
+    SemaphoreHandle_t TxSem;
+    TaskHandle_t volatile RxTask;
+
+} ttyRtos;
+
+#endif /* BSP_RTOS == BSP_ENABLED */
+
 #if BSP_TTY_TX_DMA == BSP_ENABLED
 
+/**
+ * @brief The tx DMA stream, see TTY_TXDMA_REQ.
+ */
+#define TTY_TXDMA                           bspDmaGetDma(TTY_TXDMA_REQ)
+#define TTY_TXDMA_STR                       bspDmaGetStream(TTY_TXDMA_REQ)
+#define TTY_TXDMA_CH                        bspDmaGetChannel(TTY_TXDMA_REQ)
+#define TTY_TXDMA_IRQn                      bspDmaGetIrq(TTY_TXDMA_REQ)
+
 /**
  * @brief TTY Data shared with the interrupt.
  */
@@ -60,36 +93,48 @@ Fifo *pTxFifo;
  */
 void startDmaTx(uint8_t *pData, size_t siz)
 {
-    LL_DMA_SetMemoryAddress(DMA1, TTY_TXDMA_STR, (uint32_t)pData);
-    LL_DMA_SetDataLength(DMA1, TTY_TXDMA_STR, siz);
+    LL_DMA_SetMemoryAddress(TTY_TXDMA, TTY_TXDMA_STR, (uint32_t)pData);
+    LL_DMA_SetDataLength(TTY_TXDMA, TTY_TXDMA_STR, siz);
     LL_USART_EnableDMAReq_TX(TTY_USARTx);
-    LL_DMA_EnableStream(DMA1, TTY_TXDMA_STR);
+    LL_DMA_EnableStream(TTY_TXDMA, TTY_TXDMA_STR);
 }
 
 /**
- * @brief TTY Tx DMA Interrupt handler.
+ * @brief TTY Tx DMA Interrupt handler, called by the stream interrupt.
  */
-extern "C" void TTY_TXDMA_STR_IRQHandler(void)
+static BSP_RAMFUNC_ISR void ttyTxDmaIsr(uint32_t flags, void *pCtx)
 {
+    BSP_ISR_ENTER(BSP_ISR_TTY_TXDMA);
+
     uint8_t *ptr = NULL;
 
-    if(TTY_TXDMACH_ISACTIVEFLAG_TC())
+    if(flags & BSP_DMA_FLAG_TC)
     {
-        TTY_TXDMACH_CLEARFLAG_TC();
-
         LL_USART_DisableDMAReq_TX(TTY_USARTx);
-        LL_DMA_DisableStream(DMA1, TTY_TXDMA_STR);
+        LL_DMA_DisableStream(TTY_TXDMA, TTY_TXDMA_STR);
 
         pTxFifo->free(ttyTxData.TxBytes);
         ttyTxData.TxBytes = pTxFifo->getReadBlock((void**)&ptr);
 
         if (ttyTxData.TxBytes != 0)
             startDmaTx(ptr, ttyTxData.TxBytes);
+
+#if BSP_RTOS == BSP_ENABLED
+
+        /* Wakes up a writer waiting for space in the fifo */
+        BaseType_t woken = pdFALSE;
+
+        xSemaphoreGiveFromISR(ttyRtos.TxSem, &woken);
+        portYIELD_FROM_ISR(woken);
+
+#endif /* BSP_RTOS == BSP_ENABLED */
     }
     else
     {
         bspDoAssert();
     }
+
+    BSP_ISR_EXIT(BSP_ISR_TTY_TXDMA);
 }
 
 #endif /* BSP_TTY_TX_DMA == BSP_ENABLED */
@@ -103,6 +148,8 @@ struct
 {
     char Data[BSP_TTY_RX_BUFSIZ];
     uint32_t NumLost;
+    bspTTYNotify_t Notify;
+    void *pCtx;
 
 } ttyRxData;
 
@@ -111,8 +158,10 @@ struct
  */
 Fifo *pRxFifo;
 
-extern "C" void TTY_USARTx_IRQHandler(void)
+extern "C" BSP_RAMFUNC_ISR void TTY_USARTx_IRQHandler(void)
 {
+    BSP_ISR_ENTER(BSP_ISR_TTY_USART);
+
     if(   LL_USART_IsActiveFlag_RXNE(TTY_USARTx) 
        && LL_USART_IsEnabledIT_RXNE(TTY_USARTx))
     {
@@ -120,33 +169,60 @@ extern "C" void TTY_USARTx_IRQHandler(void)
 
         if (pRxFifo->put(&data))
             ttyRxData.NumLost++;
+
+        if (ttyRxData.Notify != NULL)
+            ttyRxData.Notify(ttyRxData.pCtx);
+
+#if BSP_RTOS == BSP_ENABLED
+
+        if (ttyRtos.RxTask != NULL)
+        {
+            BaseType_t woken = pdFALSE;
+
+            vTaskNotifyGiveFromISR(ttyRtos.RxTask, &woken);
+            portYIELD_FROM_ISR(woken);
+        }
+
+#endif /* BSP_RTOS == BSP_ENABLED */
     }
+
+    BSP_ISR_EXIT(BSP_ISR_TTY_USART);
 }
 
 #endif /* BSP_TTY_RX_IRQ == BSP_ENABLED */
 
+#if BSP_TTY_TX_DMA == BSP_ENABLED && BSP_TTY_BLOCKING == BSP_ENABLED
+
 /**
- * @brief Called by c library for printf calls.
- *
- * @param file      The used Stream number.
- * @param pData     The data to write.
- * @param siz       The number of bytes to write.
- *
- * @return  siz,if BSP_TTY_BLOCKING is disabled.
- *          The number of bytes really written to the tx buffer
- *          if BSP_TTY_BLOCKING is enabled.
+ * @brief Waits until the tx DMA has freed some space in the fifo, blocks on
+ * the tx semaphore if possible and busy waits otherwise.
  */
+static inline void ttyTxWait(void)
+{
+#if BSP_RTOS == BSP_ENABLED
 
-extern "C" int _write(int file, char *pData, int siz)
+    if (bspRtosCanBlock())
+        xSemaphoreTake(ttyRtos.TxSem, portMAX_DELAY);
+
+#endif /* BSP_RTOS == BSP_ENABLED */
+}
+
+#endif /* BSP_TTY_TX_DMA == BSP_ENABLED && BSP_TTY_BLOCKING == BSP_ENABLED */
+
+/**
+ * @brief Writes the given data to the tty, see _write().
+ */
+static int ttyWrite(char *pData, int siz)
 {
 #if BSP_TTY_TX_DMA == BSP_ENABLED
 
     int tmp = 0;
     uint8_t *ptr = NULL;
+    uint32_t crit = 0;
 
     do
     {
-        NVIC_DisableIRQ(TTY_TXDMA_STR_IRQn);
+        crit = bspCriticalEnter();
 
         if ((siz - tmp) == 1)
             tmp += pTxFifo->put(pData + tmp);
@@ -159,11 +235,12 @@ extern "C" int _write(int file, char *pData, int siz)
             startDmaTx(ptr, ttyTxData.TxBytes);
         }
 
-        NVIC_EnableIRQ(TTY_TXDMA_STR_IRQn);
+        bspCriticalExit(crit);
 
 #if BSP_TTY_BLOCKING == BSP_ENABLED
 
-        while (pTxFifo->getFree() == 0 && (tmp < siz));
+        while (pTxFifo->getFree() == 0 && (tmp < siz))
+            ttyTxWait();
 
     } while (tmp < siz);
     
@@ -194,6 +271,40 @@ extern "C" int _write(int file, char *pData, int siz)
     return -1;
 }
 
+/**
+ * @brief Called by c library for printf calls.
+ *
+ * If BSP_RTOS is enabled and called by a task the whole call is protected 
+ * by a mutex, so the output of concurrent tasks does not interleave.
+ *
+ * @param file      The used Stream number.
+ * @param pData     The data to write.
+ * @param siz       The number of bytes to write.
+ *
+ * @return  siz,if BSP_TTY_BLOCKING is disabled.
+ *          The number of bytes really written to the tx buffer
+ *          if BSP_TTY_BLOCKING is enabled.
+ */
+extern "C" int _write(int file, char *pData, int siz)
+{
+#if BSP_RTOS == BSP_ENABLED
+
+    int ret = 0;
+
+    if (bspRtosCanBlock() && ttyRtos.Mutex != NULL)
+    {
+        xSemaphoreTake(ttyRtos.Mutex, portMAX_DELAY);
+        ret = ttyWrite(pData, siz);
+        xSemaphoreGive(ttyRtos.Mutex);
+
+        return ret;
+    }
+
+#endif /* BSP_RTOS == BSP_ENABLED */
+
+    return ttyWrite(pData, siz);
+}
+
 /**
  * @brief Called by scanf calls to read from the given stream.
  *
@@ -222,14 +333,24 @@ void bspTTYInit(uint32_t baud)
     LL_USART_Init(TTY_USARTx, &init);
     
     LL_USART_Enable(TTY_USARTx);
+    ttyBaud = baud;
+
+#if BSP_RTOS == BSP_ENABLED
+
+    /* Creating the objects before the scheduler has been started is fine */
+    ttyRtos.Mutex = xSemaphoreCreateMutex();
+    ttyRtos.TxSem = xSemaphoreCreateBinary();
+    ttyRtos.RxTask = NULL;
+    bspAssert(ttyRtos.Mutex != NULL && ttyRtos.TxSem != NULL);
+
+#endif /* BSP_RTOS == BSP_ENABLED */
 
 #if BSP_TTY_RX_IRQ == BSP_ENABLED
 
     ttyRxData.NumLost = 0;
     pRxFifo = new Fifo(ttyRxData.Data, sizeof(ttyRxData.Data));
 
-    NVIC_SetPriority(USART2_IRQn, BSP_IRQPRIO_TTY);
-    NVIC_EnableIRQ(USART2_IRQn);
+    bspIrqEnable(TTY_USARTx_IRQn, BSP_IRQPRIO_TTY);
     LL_USART_EnableIT_RXNE(TTY_USARTx);
 
 #endif /* BSP_TTY_RX_IRQ == BSP_ENABLED */
@@ -252,12 +373,11 @@ void bspTTYInit(uint32_t baud)
     dma.MemoryOrM2MDstDataSize = LL_DMA_MDATAALIGN_BYTE;
     dma.PeriphOrM2MSrcDataSize = LL_DMA_PDATAALIGN_BYTE;
     dma.PeriphOrM2MSrcAddress = LL_USART_DMA_GetRegAddr(TTY_USARTx);
-    LL_DMA_Init(DMA1, TTY_TXDMA_STR, &dma);
+    LL_DMA_Init(TTY_TXDMA, TTY_TXDMA_STR, &dma);
 
-    NVIC_SetPriority(TTY_TXDMA_STR_IRQn, 0);
-    NVIC_EnableIRQ(TTY_TXDMA_STR_IRQn);
-    LL_DMA_EnableIT_TC(DMA1, TTY_TXDMA_STR);
-    LL_DMA_EnableIT_TE(DMA1, TTY_TXDMA_STR);
+    bspDmaClaim(TTY_TXDMA_REQ, ttyTxDmaIsr, NULL, BSP_IRQPRIO_TTY);
+    LL_DMA_EnableIT_TC(TTY_TXDMA, TTY_TXDMA_STR);
+    LL_DMA_EnableIT_TE(TTY_TXDMA, TTY_TXDMA_STR);
 
 #endif /* BSP_TTY_TX_DMA == BSP_ENABLED */
 }
@@ -272,6 +392,48 @@ bspStatus_t bspTTYSendData(uint8_t *pData, uint16_t siz)
     return ret;
 }
 
+void bspTTYFlush(void)
+{
+    if (ttyBaud == 0)
+        return;
+
+#if BSP_TTY_TX_DMA == BSP_ENABLED
+
+    while (ttyTxData.TxBytes != 0);
+
+#endif /* BSP_TTY_TX_DMA == BSP_ENABLED */
+
+    while (!LL_USART_IsActiveFlag_TC(TTY_USARTx));
+}
+
+void bspTTYClockUpdate(void)
+{
+    uint32_t hclk = 0;
+
+    if (ttyBaud == 0)
+        return;
+
+    hclk = __LL_RCC_CALC_HCLK_FREQ(SystemCoreClock, LL_RCC_GetAHBPrescaler());
+
+    LL_USART_SetBaudRate(TTY_USARTx, 
+        __LL_RCC_CALC_PCLK1_FREQ(hclk, LL_RCC_GetAPB1Prescaler()), 
+        LL_USART_GetOverSampling(TTY_USARTx), ttyBaud);
+}
+
+#if BSP_TTY_RX_IRQ == BSP_ENABLED
+
+void bspTTYSetRxNotify(bspTTYNotify_t cb, void *pCtx)
+{
+    uint32_t crit = bspCriticalEnter();
+
+    ttyRxData.Notify = cb;
+    ttyRxData.pCtx = pCtx;
+
+    bspCriticalExit(crit);
+}
+
+#endif /* BSP_TTY_RX_IRQ == BSP_ENABLED */
+
 bool bspTTYDataAvailable(void)
 {
 #if BSP_TTY_RX_IRQ == BSP_ENABLED
@@ -287,6 +449,21 @@ bool bspTTYDataAvailable(void)
 
 char bspTTYGetChar(void)
 {
+#if BSP_RTOS == BSP_ENABLED
+
+    if (bspRtosCanBlock())
+    {
+        /* Registered before the check, so no character can be missed */
+        ttyRtos.RxTask = xTaskGetCurrentTaskHandle();
+
+        while (!bspTTYDataAvailable())
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        ttyRtos.RxTask = NULL;
+    }
+
+#endif /* BSP_RTOS == BSP_ENABLED */
+
     while (!bspTTYDataAvailable());
 
 #if BSP_TTY_RX_IRQ == BSP_ENABLED
@@ -307,16 +484,29 @@ char bspTTYGetChar(void)
 
 void bspTTYAssertMessage(char *pChar)
 {
+    uint32_t start;
+    uint32_t charCycles;
+
+    /* Nothing to print to before bspTTYInit() */
+    if (ttyBaud == 0)
+        return;
+
+    /* Twice the time of a character, so a stuck tty can not block the
+     * caller forever */
+    charCycles = (SystemCoreClock / ttyBaud) * 10 * 2;
+
 #if BSP_TTY_TX_DMA == BSP_ENABLED
 
     /* If a transfer is ongoing let it complete and disable the DMA once it 
      * is done */
-    if(LL_DMA_IsEnabledStream(DMA1, TTY_TXDMA_STR))
+    if(LL_DMA_IsEnabledStream(TTY_TXDMA, TTY_TXDMA_STR))
     {
-        while(!TTY_TXDMACH_ISACTIVEFLAG_TC());
-        TTY_TXDMACH_CLEARFLAG_TC();
+        start = bspGetCycleCount();
+        while(!(bspDmaGetFlags(TTY_TXDMA_REQ) & BSP_DMA_FLAG_TC) && 
+            bspGetCycleCount() - start < charCycles * sizeof(ttyTxData.Data));
+        bspDmaClearFlags(TTY_TXDMA_REQ, BSP_DMA_FLAG_TC);
         LL_USART_DisableDMAReq_TX(TTY_USARTx);
-        LL_DMA_DisableStream(DMA1, TTY_TXDMA_STR);
+        LL_DMA_DisableStream(TTY_TXDMA, TTY_TXDMA_STR);
     }
 
 #endif /* BSP_TTY_TX_DMA == BSP_ENABLED */    
@@ -324,7 +514,13 @@ void bspTTYAssertMessage(char *pChar)
     /* Do use DMA here as interrupts will most likely not work anymore */
     while (*pChar != 0)
     {
-        while (!LL_USART_IsActiveFlag_TXE(TTY_USARTx));
+        start = bspGetCycleCount();
+        while (!LL_USART_IsActiveFlag_TXE(TTY_USARTx))
+        {
+            if (bspGetCycleCount() - start > charCycles)
+                return;
+        }
+
         LL_USART_TransmitData8(TTY_USARTx, *pChar);
         pChar++;
     }
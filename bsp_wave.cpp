@@ -0,0 +1,220 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+#include <stm32f4xx_ll_dma.h>
+#include <stm32f4xx_ll_tim.h>
+
+#include "bsp/bsp.h"
+#include "bsp/bsp_assert.h"
+#include "bsp/bsp_dma.h"
+#include "bsp/bsp_isr.h"
+#include "bsp/bsp_wave.h"
+
+#if BSP_WAVE == BSP_ENABLED
+
+/**
+ * @brief The timer and its DMA stream, see BSP_WAVE_DMA_REQ.
+ */
+#define WAVE_TIM                            TIM8
+#define WAVE_DMA                            bspDmaGetDma(BSP_WAVE_DMA_REQ)
+#define WAVE_DMA_STR                        bspDmaGetStream(BSP_WAVE_DMA_REQ)
+#define WAVE_DMA_CH                         bspDmaGetChannel(BSP_WAVE_DMA_REQ)
+
+/**
+ * @brief Waveform data shared with the interrupt.
+ */
+static struct
+{
+    bspWaveMode_t Mode;
+    uint32_t *pBuf[2];
+    uint16_t Len;
+    bspWaveCb_t Cb;
+    void *pCtx;
+    uint32_t Rate;
+    volatile bool Busy;
+
+} waveData;
+
+/**
+ * @brief Calls the user callback, if any.
+ */
+static inline void waveCallback(uint32_t *pBuf, uint16_t len)
+{
+    if (waveData.Cb != 0)
+        waveData.Cb(pBuf, len, waveData.pCtx);
+}
+
+/**
+ * @brief Waveform DMA interrupt handler, called by the stream interrupt.
+ */
+static void waveDmaIsr(uint32_t flags, void *pCtx)
+{
+    BSP_ISR_ENTER(BSP_ISR_WAVE);
+
+    if (flags & BSP_DMA_FLAG_TE)
+    {
+        /* Most likely a buffer in a region the DMA can not access */
+        bspWaveStop();
+        bspDoAssert();
+        flags = 0;
+    }
+
+    if (flags & BSP_DMA_FLAG_HT)
+    {
+        waveCallback(waveData.pBuf[0], waveData.Len / 2);
+    }
+
+    if (flags & BSP_DMA_FLAG_TC)
+    {
+
+        switch (waveData.Mode)
+        {
+            case BSP_WAVE_ONESHOT:
+
+                bspWaveStop();
+                waveCallback(waveData.pBuf[0], waveData.Len);
+                break;
+
+            case BSP_WAVE_CIRCULAR:
+
+                waveCallback(waveData.pBuf[0] + waveData.Len / 2, 
+                    waveData.Len - waveData.Len / 2);
+                break;
+
+            case BSP_WAVE_DOUBLEBUF:
+
+                /* The stream has already switched to the other buffer */
+                if (LL_DMA_GetCurrentTargetMem(WAVE_DMA, WAVE_DMA_STR) == 
+                    LL_DMA_CURRENTTARGETMEM1)
+                    waveCallback(waveData.pBuf[0], waveData.Len);
+                else
+                    waveCallback(waveData.pBuf[1], waveData.Len);
+                break;
+        }
+    }
+
+    BSP_ISR_EXIT(BSP_ISR_WAVE);
+}
+
+void bspWaveInit(void)
+{
+    waveData.Busy = false;
+
+    bspDmaClaim(BSP_WAVE_DMA_REQ, waveDmaIsr, NULL, BSP_IRQPRIO_WAVE);
+}
+
+bspStatus_t bspWaveStart(const bspWaveCfg_t *pCfg)
+{
+    LL_DMA_InitTypeDef dma;
+    uint32_t clk = bspGetTimClock(WAVE_TIM);
+
+    if (waveData.Busy)
+        return BSP_EBUSY;
+
+    /* The timer needs a auto reload value of at least 1 */
+    if (   pCfg->pBuf[0] == 0 || pCfg->Len == 0
+        || pCfg->RateHz == 0 || pCfg->RateHz > clk / 2)
+        return BSP_EEINVAL;
+
+    if (pCfg->Mode == BSP_WAVE_CIRCULAR && (pCfg->Len & 1) != 0)
+        return BSP_EEINVAL;
+
+    if (pCfg->Mode == BSP_WAVE_DOUBLEBUF && pCfg->pBuf[1] == 0)
+        return BSP_EEINVAL;
+
+    waveData.Mode = pCfg->Mode;
+    waveData.pBuf[0] = pCfg->pBuf[0];
+    waveData.pBuf[1] = pCfg->pBuf[1];
+    waveData.Len = pCfg->Len;
+    waveData.Cb = pCfg->Cb;
+    waveData.pCtx = pCfg->pCtx;
+
+    /* Load the prescaler while the dma request is still disabled, otherwise 
+     * the update event would already trigger a transfer */
+    waveData.Rate = bspTimSetRate(WAVE_TIM, pCfg->RateHz);
+
+    LL_DMA_StructInit(&dma);
+    dma.Channel = WAVE_DMA_CH;
+    dma.Mode = pCfg->Mode == BSP_WAVE_ONESHOT ? 
+        LL_DMA_MODE_NORMAL : LL_DMA_MODE_CIRCULAR;
+    dma.Direction = LL_DMA_DIRECTION_MEMORY_TO_PERIPH;
+    dma.Priority = LL_DMA_PRIORITY_VERYHIGH;
+    dma.MemoryOrM2MDstIncMode = LL_DMA_MEMORY_INCREMENT;
+    dma.PeriphOrM2MSrcIncMode = LL_DMA_PERIPH_NOINCREMENT;
+    dma.MemoryOrM2MDstDataSize = LL_DMA_MDATAALIGN_WORD;
+    dma.PeriphOrM2MSrcDataSize = LL_DMA_PDATAALIGN_WORD;
+    dma.PeriphOrM2MSrcAddress = (uint32_t) &BSP_IOMAPPORT(pCfg->Port)->BSRR;
+    dma.MemoryOrM2MDstAddress = (uint32_t) pCfg->pBuf[0];
+    dma.NbData = pCfg->Len;
+    LL_DMA_Init(WAVE_DMA, WAVE_DMA_STR, &dma);
+
+    if (pCfg->Mode == BSP_WAVE_DOUBLEBUF)
+    {
+        LL_DMA_SetMemory1Address(WAVE_DMA, WAVE_DMA_STR, 
+            (uint32_t) pCfg->pBuf[1]);
+        LL_DMA_SetCurrentTargetMem(WAVE_DMA, WAVE_DMA_STR, 
+            LL_DMA_CURRENTTARGETMEM0);
+        LL_DMA_EnableDoubleBufferMode(WAVE_DMA, WAVE_DMA_STR);
+    }
+    else
+    {
+        LL_DMA_DisableDoubleBufferMode(WAVE_DMA, WAVE_DMA_STR);
+    }
+
+    if (pCfg->Mode == BSP_WAVE_CIRCULAR)
+        LL_DMA_EnableIT_HT(WAVE_DMA, WAVE_DMA_STR);
+    else
+        LL_DMA_DisableIT_HT(WAVE_DMA, WAVE_DMA_STR);
+
+    LL_DMA_EnableIT_TC(WAVE_DMA, WAVE_DMA_STR);
+    LL_DMA_EnableIT_TE(WAVE_DMA, WAVE_DMA_STR);
+
+    waveData.Busy = true;
+
+    LL_DMA_EnableStream(WAVE_DMA, WAVE_DMA_STR);
+    LL_TIM_EnableDMAReq_UPDATE(WAVE_TIM);
+    LL_TIM_EnableCounter(WAVE_TIM);
+
+    return BSP_OK;
+}
+
+void bspWaveStop(void)
+{
+    LL_TIM_DisableCounter(WAVE_TIM);
+    LL_TIM_DisableDMAReq_UPDATE(WAVE_TIM);
+
+    bspDmaStop(BSP_WAVE_DMA_REQ);
+
+    waveData.Busy = false;
+}
+
+bool bspWaveIsBusy(void)
+{
+    return waveData.Busy;
+}
+
+uint32_t bspWaveGetRate(void)
+{
+    return waveData.Rate;
+}
+
+#endif /* BSP_WAVE == BSP_ENABLED */
@@ -0,0 +1,244 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+
+#include <stm32f4xx_ll_bus.h>
+#include <stm32f4xx_ll_iwdg.h>
+#include <stm32f4xx_ll_pwr.h>
+#include <stm32f4xx_ll_rtc.h>
+#include <stm32f4xx_ll_system.h>
+
+#include "bsp/bsp.h"
+#include "bsp/bsp_crash.h"
+#include "bsp/bsp_evlog.h"
+#include "bsp/bsp_wdg.h"
+
+#if BSP_WDG == BSP_ENABLED
+
+#if BSP_WDG_CLIENTS < 1 || BSP_WDG_CLIENTS > 32
+#error BSP_WDG_CLIENTS has to be 1 to 32
+#endif
+
+/**
+ * @brief Nominal frequency of the LSI which clocks the watchdog.
+ */
+#define WDG_LSI_HZ                          32000
+
+/**
+ * @brief The watchdog ticks at the LSI divided by 4 with prescaler 0, the
+ * reload value has 12 bits.
+ */
+#define WDG_TICKS                           (BSP_WDG_TIMEOUT_MS * \
+                                            (WDG_LSI_HZ / 1000) / 4)
+#define WDG_RELOAD_MAX                      0x0FFF
+
+static_assert(WDG_TICKS >= 1 && WDG_TICKS <= (WDG_RELOAD_MAX + 1) * 64,
+    "BSP_WDG_TIMEOUT_MS out of range");
+
+static_assert(BSP_WDG_BKP_REG <= LL_RTC_BKP_DR19,
+    "BSP_WDG_BKP_REG out of range");
+
+/**
+ * @brief Marks a valid client in the upper half of the backup register.
+ */
+#define WDG_BKP_MAGIC                       0x5744UL
+
+/**
+ * @brief Client data shared with the sys tick interrupt.
+ */
+static struct
+{
+    volatile uint32_t Active;       ///<! A bit per added client
+    bool Missed;
+    bool LastValid;                 ///<! LastClient missed before the reset
+    uint32_t LastClient;
+
+    struct
+    {
+        const char *pName;
+        uint32_t Timeout;
+        volatile uint32_t Deadline;
+
+    } Client[BSP_WDG_CLIENTS];
+
+} wdgData;
+
+/**
+ * @brief Records the client which missed its deadline.
+ */
+static void wdgMissed(uint32_t client)
+{
+    wdgData.Missed = true;
+
+    /* Kept by the reset in any configuration */
+    LL_RTC_BAK_SetRegister(RTC, BSP_WDG_BKP_REG, 
+        (WDG_BKP_MAGIC << 16) | client);
+
+#if BSP_CRASH == BSP_ENABLED
+
+    bspCrashWatchdog(client, wdgData.Client[client].pName);
+
+#endif /* BSP_CRASH == BSP_ENABLED */
+
+#if BSP_EVLOG == BSP_ENABLED
+
+    bspEvLog(BSP_EVLOG_ID_WDG, client);
+
+#endif /* BSP_EVLOG == BSP_ENABLED */
+
+}
+
+void bspWdgInit(void)
+{
+    uint32_t ticks = WDG_TICKS;
+    uint32_t psc = 0;
+    uint32_t bkp = 0;
+
+    /* The backup access is cleared by each reset */
+    LL_APB1_GRP1_EnableClock(LL_APB1_GRP1_PERIPH_PWR);
+    LL_PWR_EnableBkUpAccess();
+
+    bkp = LL_RTC_BAK_GetRegister(RTC, BSP_WDG_BKP_REG);
+    wdgData.LastValid = (bkp >> 16) == WDG_BKP_MAGIC;
+    wdgData.LastClient = bkp & 0xFFFF;
+    LL_RTC_BAK_SetRegister(RTC, BSP_WDG_BKP_REG, 0);
+
+    /* Find the smallest prescaler the reload value fits for */
+    while (ticks > WDG_RELOAD_MAX + 1)
+    {
+        ticks /= 2;
+        psc++;
+    }
+
+    LL_DBGMCU_APB1_GRP1_FreezePeriph(LL_DBGMCU_APB1_GRP1_IWDG_STOP);
+
+    /* Also starts the LSI */
+    LL_IWDG_Enable(IWDG);
+    LL_IWDG_EnableWriteAccess(IWDG);
+    LL_IWDG_SetPrescaler(IWDG, psc);
+    LL_IWDG_SetReloadCounter(IWDG, ticks - 1);
+    while (!LL_IWDG_IsReady(IWDG));
+    LL_IWDG_ReloadCounter(IWDG);
+}
+
+bspStatus_t bspWdgAdd(uint32_t client, const char *pName, uint32_t timeout)
+{
+    uint32_t crit = 0;
+    bspStatus_t ret = BSP_OK;
+
+    if (client >= BSP_WDG_CLIENTS || pName == 0 || timeout == 0)
+        return BSP_EEINVAL;
+
+    crit = bspCriticalEnter();
+
+    if (wdgData.Active & (1UL << client))
+    {
+        ret = BSP_EBUSY;
+    }
+    else
+    {
+        wdgData.Client[client].pName = pName;
+        wdgData.Client[client].Timeout = timeout;
+        wdgData.Client[client].Deadline = bspGetSysTick() + timeout;
+        wdgData.Active |= 1UL << client;
+    }
+
+    bspCriticalExit(crit);
+
+    return ret;
+}
+
+void bspWdgRemove(uint32_t client)
+{
+    uint32_t crit = 0;
+
+    if (client >= BSP_WDG_CLIENTS)
+        return;
+
+    crit = bspCriticalEnter();
+    wdgData.Active &= ~(1UL << client);
+    bspCriticalExit(crit);
+}
+
+void bspWdgCheckIn(uint32_t client)
+{
+    if (client >= BSP_WDG_CLIENTS)
+        return;
+
+    /* A single store, so no need to lock */
+    wdgData.Client[client].Deadline =
+        bspGetSysTick() + wdgData.Client[client].Timeout;
+}
+
+void bspWdgTick(void)
+{
+    uint32_t now = 0;
+    uint32_t active = 0;
+
+    /* Once missed the watchdog is left to expire */
+    if (wdgData.Missed)
+        return;
+
+    now = bspGetSysTick();
+    active = wdgData.Active;
+
+    while (active != 0)
+    {
+        uint32_t client = 31 - __CLZ(active);
+
+        active &= ~(1UL << client);
+
+        if ((int32_t)(now - wdgData.Client[client].Deadline) > 0)
+        {
+            wdgMissed(client);
+            return;
+        }
+    }
+
+    LL_IWDG_ReloadCounter(IWDG);
+}
+
+bool bspWdgGetMissed(uint32_t *pClient)
+{
+    if (wdgData.LastValid && pClient != 0)
+        *pClient = wdgData.LastClient;
+
+    return wdgData.LastValid;
+}
+
+void bspWdgExpire(void)
+{
+    /* Does nothing if already running */
+    LL_IWDG_Enable(IWDG);
+    LL_IWDG_EnableWriteAccess(IWDG);
+
+    /* The registers can not be written while a update is ongoing */
+    while (!LL_IWDG_IsReady(IWDG));
+    LL_IWDG_SetPrescaler(IWDG, LL_IWDG_PRESCALER_4);
+    LL_IWDG_SetReloadCounter(IWDG, 1);
+    while (!LL_IWDG_IsReady(IWDG));
+    LL_IWDG_ReloadCounter(IWDG);
+
+    while (1);
+}
+
+#endif /* BSP_WDG == BSP_ENABLED */
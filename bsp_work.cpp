@@ -0,0 +1,177 @@
+/*
+ * bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+ * projects.
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+ */
+
+
+#include "bsp/bsp.h"
+#include "bsp/bsp_isr.h"
+#include "bsp/bsp_work.h"
+
+#include <stddef.h>
+
+#if BSP_WORK == BSP_ENABLED
+
+#if (BSP_WORK_SIZE & (BSP_WORK_SIZE - 1)) != 0
+#error BSP_WORK_SIZE has to be a power of two
+#endif
+
+/**
+ * @brief The work queue. 
+ * 
+ * Slot n is free for the poster at position n when its sequence number is 
+ * n and ready for the consumer once it is n + 1. The consumer hands it 
+ * back for the next round by setting it to n + BSP_WORK_SIZE.
+ */
+static struct
+{
+    struct
+    {
+        bspWorkFn_t Fn;
+        void *pCtx;
+        uint32_t Arg;
+        volatile uint32_t Seq;
+
+    } Slot[BSP_WORK_SIZE];
+
+    volatile uint32_t Head;
+    volatile uint32_t Tail;
+    volatile uint32_t Dropped;
+
+} workData;
+
+#if BSP_WORK_PENDSV == BSP_ENABLED
+
+extern "C" void PendSV_Handler(void)
+{
+    BSP_ISR_ENTER(BSP_ISR_WORK);
+
+    bspRunPending();
+
+    BSP_ISR_EXIT(BSP_ISR_WORK);
+}
+
+#endif /* BSP_WORK_PENDSV == BSP_ENABLED */
+
+void bspWorkInit(void)
+{
+    for (uint32_t i = 0; i < BSP_WORK_SIZE; i++)
+        workData.Slot[i].Seq = i;
+
+    workData.Head = 0;
+    workData.Tail = 0;
+    workData.Dropped = 0;
+
+#if BSP_WORK_PENDSV == BSP_ENABLED
+
+    NVIC_SetPriority(PendSV_IRQn, BSP_IRQPRIO_MIN);
+
+#endif /* BSP_WORK_PENDSV == BSP_ENABLED */
+}
+
+bspStatus_t bspWorkPost(bspWorkFn_t fn, void *pCtx, uint32_t arg)
+{
+    uint32_t pos = 0;
+    uint32_t idx = 0;
+    uint32_t cnt = 0;
+    int32_t diff = 0;
+
+    if (fn == NULL)
+        return BSP_EEINVAL;
+
+    do
+    {
+        pos = __LDREXW(&workData.Head);
+        idx = pos & (BSP_WORK_SIZE - 1);
+        diff = (int32_t)(workData.Slot[idx].Seq - pos);
+
+        if (diff < 0)
+        {
+            /* Not yet consumed since the last round */
+            __CLREX();
+
+            do
+            {
+                cnt = __LDREXW(&workData.Dropped);
+            } while (__STREXW(cnt + 1, &workData.Dropped) != 0);
+
+            return BSP_EBUSY;
+        }
+
+        /* A diff above zero means the slot has just been claimed by a 
+         * preempting poster, the store fails as the exception return has 
+         * cleared the monitor */
+
+    } while (diff != 0 || __STREXW(pos + 1, &workData.Head) != 0);
+
+    workData.Slot[idx].Fn = fn;
+    workData.Slot[idx].pCtx = pCtx;
+    workData.Slot[idx].Arg = arg;
+
+    /* Publish the slot after its content */
+    __DMB();
+    workData.Slot[idx].Seq = pos + 1;
+
+#if BSP_WORK_PENDSV == BSP_ENABLED
+
+    SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+
+#endif /* BSP_WORK_PENDSV == BSP_ENABLED */
+
+    return BSP_OK;
+}
+
+uint32_t bspRunPending(void)
+{
+    uint32_t cnt = 0;
+    uint32_t pos = workData.Tail;
+    uint32_t idx = pos & (BSP_WORK_SIZE - 1);
+    bspWorkFn_t fn = NULL;
+    void *pCtx = NULL;
+    uint32_t arg = 0;
+
+    while (workData.Slot[idx].Seq == pos + 1)
+    {
+        __DMB();
+        fn = workData.Slot[idx].Fn;
+        pCtx = workData.Slot[idx].pCtx;
+        arg = workData.Slot[idx].Arg;
+
+        /* Hand the slot back before running, so the work function can post
+         * again */
+        __DMB();
+        workData.Slot[idx].Seq = pos + BSP_WORK_SIZE;
+        workData.Tail = ++pos;
+
+        fn(pCtx, arg);
+        cnt++;
+
+        idx = pos & (BSP_WORK_SIZE - 1);
+    }
+
+    return cnt;
+}
+
+uint32_t bspWorkGetDropped(void)
+{
+    return workData.Dropped;
+}
+
+#endif /* BSP_WORK == BSP_ENABLED */
@@ -0,0 +1,209 @@
+#!/usr/bin/env python3
+#
+# bsp-nucleo-f446, a generic board support package for nucleo-f446 based
+# projects.
+#
+# Copyright (C) 2020 Julian Friedrich
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+# You can file issues at https://github.com/fjulian79/bsp-nucleo-f446
+
+"""
+Turns the output of bspProfDump() into a flat profile.
+
+The tty output is read from a capture file, from stdin or directly from a
+serial port (needs pyserial). Addresses are mapped to functions by the symbol
+table of the elf file, read with arm-none-eabi-nm.
+
+Examples:
+    bsp_prof.py firmware.elf capture.txt
+    bsp_prof.py firmware.elf --port /dev/ttyACM0 --blocks 10
+"""
+
+import argparse
+import bisect
+import collections
+import re
+import subprocess
+import sys
+
+# address, optional size, kind and name as printed by nm --print-size
+NM_LINE = re.compile(r"^([0-9a-fA-F]+) (?:([0-9a-fA-F]+) )?(\w) (.*)$")
+
+
+class SymbolTable:
+    """Maps addresses to the function containing them."""
+
+    def __init__(self, elf, nm):
+        out = subprocess.run(
+            [nm, "--defined-only", "--numeric-sort", "--print-size",
+             "--demangle", elf],
+            check=True, capture_output=True, text=True).stdout
+
+        self.addr = []
+        self.end = []
+        self.name = []
+
+        for line in out.splitlines():
+            # The size is missing for some symbols and demangled names can
+            # contain spaces, so splitting at white space is not sufficient
+            match = NM_LINE.match(line)
+            if not match:
+                continue
+
+            addr, size, kind, name = match.groups()
+            size = int(size, 16) if size else 0
+
+            if kind not in "tTwW":
+                continue
+
+            # Thumb symbols have bit 0 set
+            addr = int(addr, 16) & ~1
+            self.addr.append(addr)
+            self.end.append(addr + size if size else None)
+            self.name.append(name)
+
+    def lookup(self, addr):
+        addr &= ~1
+        idx = bisect.bisect_right(self.addr, addr) - 1
+        if idx < 0:
+            return "?? 0x%08x" % addr
+
+        end = self.end[idx]
+        if end is None and idx + 1 < len(self.addr):
+            end = self.addr[idx + 1]
+
+        if end is not None and addr >= end:
+            return "?? 0x%08x" % addr
+
+        return self.name[idx]
+
+
+def read_lines(args):
+    if args.port:
+        import serial
+
+        with serial.Serial(args.port, args.baud, timeout=args.timeout) as tty:
+            blocks = 0
+            while args.blocks == 0 or blocks < args.blocks:
+                line = tty.readline().decode("ascii", "replace")
+                if not line:
+                    break
+                if line.startswith("#end"):
+                    blocks += 1
+                yield line
+    elif args.capture and args.capture != "-":
+        with open(args.capture, encoding="ascii", errors="replace") as f:
+            yield from f
+    else:
+        yield from sys.stdin
+
+
+def parse(lines):
+    """Returns pc counts, caller counts, samples, dropped and the rate."""
+
+    pcs = collections.Counter()
+    callers = collections.Counter()
+    samples = 0
+    dropped = 0
+    rate = 0
+    mode = None
+
+    for line in lines:
+        line = line.strip()
+
+        if line.startswith("#prof"):
+            _, mode, rate = line.split()
+            rate = int(rate)
+            continue
+
+        if line.startswith("#end"):
+            _, total, lost = line.split()
+            # the drop counter is cumulative until bspProfReset() in both
+            # modes, so the last block wins
+            dropped = int(lost)
+            if mode == "hash":
+                # hash counters are cumulative as well
+                samples = int(total)
+            mode = None
+            continue
+
+        if mode is None:
+            continue
+
+        try:
+            first, second = (int(x, 16) for x in line.split())
+        except ValueError:
+            continue
+
+        if mode == "hash":
+            pcs[first] = int(line.split()[1])
+        else:
+            pcs[first] += 1
+            callers[second] += 1
+            samples += 1
+
+    return pcs, callers, samples, dropped, rate
+
+
+def print_profile(title, counts, symbols, top):
+    funcs = collections.Counter()
+    for addr, cnt in counts.items():
+        funcs[symbols.lookup(addr)] += cnt
+
+    total = sum(funcs.values())
+    if total == 0:
+        return
+
+    print(title)
+    print("%10s %7s %7s  %s" % ("samples", "%", "cum %", "function"))
+
+    cum = 0
+    for name, cnt in funcs.most_common(top or None):
+        cum += cnt
+        print("%10d %7.2f %7.2f  %s" %
+              (cnt, 100.0 * cnt / total, 100.0 * cum / total, name))
+    print()
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Flat profile from bspProfDump() output.")
+    parser.add_argument("elf", help="the firmware elf file")
+    parser.add_argument("capture", nargs="?",
+                        help="captured tty output, stdin if omitted")
+    parser.add_argument("--nm", default="arm-none-eabi-nm",
+                        help="nm tool to use")
+    parser.add_argument("--port", help="read from this serial port")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--timeout", type=float, default=5.0,
+                        help="serial read timeout in seconds")
+    parser.add_argument("--blocks", type=int, default=1,
+                        help="number of dumps to read from the serial "
+                             "port, 0 until timeout")
+    parser.add_argument("--top", type=int, default=30,
+                        help="number of functions to print, 0 for all")
+    args = parser.parse_args()
+
+    symbols = SymbolTable(args.elf, args.nm)
+    pcs, callers, samples, dropped, rate = parse(read_lines(args))
+
+    print("%d samples @ %d Hz, %d dropped\n" % (samples, rate, dropped))
+    print_profile("flat profile:", pcs, symbols, args.top)
+    print_profile("callers (lr):", callers, symbols, args.top)
+
+
+if __name__ == "__main__":
+    main()